@@ -0,0 +1,1316 @@
+/* posix_openpt, ptsname */
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+
+#include "tclln.h"
+#include "linenoise.h"
+
+/* result of one measurement - written as json, compared against baseline */
+struct bench_result {
+    char       *name;
+    GArray     *samples;    /* double - one per repetition */
+    double     value;       /* median of samples */
+    double     min;
+    double     max;
+    const char *unit;
+    bool       higher_is_better;
+};
+
+/* baseline of a result read from json */
+struct bench_baseline_value {
+    double value;
+    double spread;          /* percent of value - 0 if not recorded */
+};
+
+/* check of two results: better must not be worse than reference */
+struct bench_check {
+    char *better;
+    char *reference;
+};
+
+/* results of all benchmarks run */
+static GArray *bench_results;
+
+/* results by name (name -> index + 1 in bench_results) */
+static GHashTable *bench_result_index;
+
+/* results of baseline (name -> struct bench_baseline_value *) */
+static GHashTable *bench_baseline;
+
+/* benchmark selected by -b (NULL for all) */
+static const char *bench_selected;
+
+/* current repetition of the benchmarks (0 for the first) */
+static int bench_repetition;
+
+/* checks evaluated on the medians after all repetitions */
+static GPtrArray *bench_checks;
+
+/* checks that failed (e.g. a fast path slower than the slow one) */
+static int bench_failures;
+
+
+static double time_now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* add sample of result - name is a printf format */
+static void bench_record (const char *unit, bool higher_is_better, double value, const char *name_format, ...)
+{
+    va_list args;
+    va_start (args, name_format);
+    char *name = g_strdup_vprintf (name_format, args);
+    va_end (args);
+
+    guint index = GPOINTER_TO_UINT (g_hash_table_lookup (bench_result_index, name));
+
+    if (index == 0) {
+        struct bench_result result;
+
+        result.name             = name;
+        result.samples          = g_array_new (false, false, sizeof (double));
+        result.value            = 0;
+        result.min              = 0;
+        result.max              = 0;
+        result.unit             = unit;
+        result.higher_is_better = higher_is_better;
+
+        g_array_append_val (bench_results, result);
+
+        index = bench_results->len;
+        g_hash_table_insert (bench_result_index, name, GUINT_TO_POINTER (index));
+    } else {
+        g_free (name);
+    }
+
+    g_array_append_val (g_array_index (bench_results, struct bench_result, index - 1).samples, value);
+}
+
+static struct bench_result *bench_result_find (const char *name)
+{
+    guint index = GPOINTER_TO_UINT (g_hash_table_lookup (bench_result_index, name));
+
+    return (index > 0 ? &g_array_index (bench_results, struct bench_result, index - 1) : NULL);
+}
+
+/* expect result better not to be worse than result reference (compared after all repetitions) */
+static void bench_expect_not_worse (const char *better, const char *reference)
+{
+    if (bench_repetition > 0) return;
+
+    struct bench_check *check = g_new (struct bench_check, 1);
+
+    check->better    = g_strdup (better);
+    check->reference = g_strdup (reference);
+
+    g_ptr_array_add (bench_checks, check);
+}
+
+static gint bench_compare_double (gconstpointer a, gconstpointer b)
+{
+    double value_a = *(const double *) a;
+    double value_b = *(const double *) b;
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+/* median, min and max of the samples of each result */
+static void bench_summarize (void)
+{
+    for (guint i = 0; i < bench_results->len; i++) {
+        struct bench_result *result = &g_array_index (bench_results, struct bench_result, i);
+        GArray *samples = result->samples;
+
+        g_array_sort (samples, bench_compare_double);
+
+        guint n = samples->len;
+
+        result->min   = g_array_index (samples, double, 0);
+        result->max   = g_array_index (samples, double, n - 1);
+        result->value = ((n % 2) ? g_array_index (samples, double, n / 2)
+                                 : (g_array_index (samples, double, n / 2 - 1) + g_array_index (samples, double, n / 2)) / 2);
+    }
+}
+
+/* range of samples in percent of the median */
+static double bench_spread (const struct bench_result *result)
+{
+    return (result->value != 0 ? (result->max - result->min) * 100 / result->value : 0);
+}
+
+/* evaluate checks of bench_expect_not_worse */
+static void bench_run_checks (void)
+{
+    for (guint i = 0; i < bench_checks->len; i++) {
+        struct bench_check *check = g_ptr_array_index (bench_checks, i);
+
+        struct bench_result *better    = bench_result_find (check->better);
+        struct bench_result *reference = bench_result_find (check->reference);
+        if ((better == NULL) || (reference == NULL)) continue;
+
+        bool worse = (better->higher_is_better ? better->value < reference->value : better->value > reference->value);
+
+        if (worse) {
+            fprintf (stderr, "Error: %s (%.6g) worse than %s (%.6g)\n", better->name, better->value, reference->name, reference->value);
+            bench_failures++;
+        }
+    }
+}
+
+static void bench_check_free (gpointer data)
+{
+    struct bench_check *check = (struct bench_check *) data;
+
+    g_free (check->better);
+    g_free (check->reference);
+    g_free (check);
+}
+
+static bool bench_enabled (const char *name)
+{
+    return ((bench_selected == NULL) || (strcmp (bench_selected, name) == 0));
+}
+
+/* write file of generated script - returns path to free by g_free or NULL */
+static char *bench_write_temp (const char *dir, const char *name, GString *content)
+{
+    char *path = g_strdup_printf ("%s/%s", dir, name);
+
+    FILE *file = fopen (path, "w");
+    if (file == NULL) {
+        fprintf (stderr, "Error: could not write %s\n", path);
+        g_free (path);
+        return NULL;
+    }
+
+    fwrite (content->str, 1, content->len, file);
+    fclose (file);
+
+    return path;
+}
+
+/* remove directory created by mkdtemp and its files */
+static void bench_remove_dir (const char *dir)
+{
+    char *command = g_strdup_printf ("rm -rf '%s'", dir);
+    if (system (command) != 0) {
+        fprintf (stderr, "Error: could not remove %s\n", dir);
+    }
+    g_free (command);
+}
+
+/* script with one command spanning n_lines lines */
+static GString *multiline_script (int n_lines)
+{
+    GString *script = g_string_new ("proc bench_proc {} {\n");
+
+    for (int i = 0; i < n_lines; i++) {
+        g_string_append_printf (script, "    set x(%d) [list a \"b c\" {d e}]\n", i);
+    }
+    g_string_append (script, "}\n");
+
+    return script;
+}
+
+/* previous approach: accumulate lines, check whole command after each line */
+static int reference_command_complete (const char *script)
+{
+    GString *input = g_string_new (NULL);
+    int n_complete = 0;
+
+    const char *line = script;
+    while (*line != '\0') {
+        const char *line_end = strchr (line, '\n');
+        size_t line_len = (line_end == NULL ? strlen (line) : (size_t) (line_end - line + 1));
+
+        g_string_append_len (input, line, line_len);
+        if (Tcl_CommandComplete (input->str)) {
+            n_complete++;
+            g_string_truncate (input, 0);
+        }
+
+        line += line_len;
+    }
+
+    g_string_free (input, true);
+
+    return n_complete;
+}
+
+static void bench_multiline_command (TclLN tclln)
+{
+    const int sizes [] = {1000, 10000, 50000, 100000};
+
+    printf ("multi-line command (ns per line):\n");
+    printf ("  %8s %16s %16s\n", "lines", "run_buffer", "CommandComplete");
+
+    for (size_t i = 0; i < G_N_ELEMENTS (sizes); i++) {
+        GString *script = multiline_script (sizes[i]);
+
+        double t_start = time_now ();
+        tclln_run_buffer (tclln, script->str, script->len);
+        double t_run = time_now () - t_start;
+
+        /* quadratic reference: skip for huge inputs and repetitions (not recorded) */
+        double t_ref = -1;
+        if ((sizes[i] <= 50000) && (bench_repetition == 0)) {
+            t_start = time_now ();
+            reference_command_complete (script->str);
+            t_ref = time_now () - t_start;
+        }
+
+        printf ("  %8d %16.1f", sizes[i], t_run * 1e9 / sizes[i]);
+        bench_record ("ns", false, t_run * 1e9 / sizes[i], "multiline.run_buffer.%d", sizes[i]);
+        if (t_ref >= 0) {
+            printf (" %16.1f\n", t_ref * 1e9 / sizes[i]);
+        } else {
+            printf (" %16s\n", "-");
+        }
+
+        g_string_free (script, true);
+    }
+}
+
+/* shell reading commands from a pipe */
+static void bench_pipe_input (TclLN tclln)
+{
+    const int n_commands = 1000000;
+
+    int fds [2];
+    if (pipe (fds) != 0) return;
+
+    pid_t writer = fork ();
+    if (writer < 0) return;
+
+    if (writer == 0) {
+        /* child: feed commands */
+        close (fds[0]);
+        FILE *input = fdopen (fds[1], "w");
+
+        fprintf (input, "set x 0\n");
+        for (int i = 0; i < n_commands; i++) {
+            if ((i % 10) == 0) {
+                fprintf (input, "if {$x >= 0} {\n    incr x\n}\n");
+            } else {
+                fprintf (input, "set y($x) %d\n", i);
+            }
+        }
+
+        fclose (input);
+        _exit (0);
+    }
+
+    close (fds[1]);
+
+    /* shell input from pipe, results to /dev/null */
+    fflush (stdout);
+    int saved_stdin  = dup (STDIN_FILENO);
+    int saved_stdout = dup (STDOUT_FILENO);
+    int null_fd      = open ("/dev/null", O_WRONLY);
+
+    dup2 (fds[0], STDIN_FILENO);
+    dup2 (null_fd, STDOUT_FILENO);
+
+    double t_start = time_now ();
+    tclln_run (tclln);
+    double t_run = time_now () - t_start;
+
+    fflush (stdout);
+    dup2 (saved_stdin,  STDIN_FILENO);
+    dup2 (saved_stdout, STDOUT_FILENO);
+    close (saved_stdin);
+    close (saved_stdout);
+    close (null_fd);
+    close (fds[0]);
+
+    waitpid (writer, NULL, 0);
+
+    printf ("shell input from pipe:\n");
+    printf ("  %d commands: %.0f commands/s\n", n_commands, n_commands / t_run);
+    bench_record ("commands/s", true, n_commands / t_run, "pipe_input");
+}
+
+static void bench_startup (void)
+{
+    const int n_instances = 20;
+    const int options [] = {0, TCLLN_LAZY_INIT};
+    const char *names [] = {"default", "lazy init"};
+
+    const char *keys [] = {"default", "lazy_init"};
+
+    printf ("tclln_new phases (us per instance):\n");
+    printf ("  %-10s %10s %10s %10s %10s %10s %10s\n", "options", "interp", "encoding", "init", "completion", "total", "free");
+
+    for (size_t i = 0; i < G_N_ELEMENTS (options); i++) {
+        unsigned long sum_interp = 0, sum_encoding = 0, sum_init = 0, sum_completion = 0;
+        double t_total = 0;
+        double t_free  = 0;
+
+        for (int j = 0; j < n_instances; j++) {
+            double t_start = time_now ();
+            TclLN instance = tclln_new_with_options (NULL, options[i]);
+            t_total += time_now () - t_start;
+
+            unsigned long t_interp, t_encoding, t_init, t_completion;
+            tclln_startup_times (instance, &t_interp, &t_encoding, &t_init, &t_completion);
+
+            sum_interp     += t_interp;
+            sum_encoding   += t_encoding;
+            sum_init       += t_init;
+            sum_completion += t_completion;
+
+            t_start = time_now ();
+            tclln_free (instance);
+            t_free += time_now () - t_start;
+        }
+
+        printf ("  %-10s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", names[i],
+                sum_interp * 1e-3 / n_instances, sum_encoding * 1e-3 / n_instances,
+                sum_init * 1e-3 / n_instances, sum_completion * 1e-3 / n_instances,
+                t_total * 1e6 / n_instances, t_free * 1e6 / n_instances);
+
+        bench_record ("us", false, t_total * 1e6 / n_instances, "startup.%s.new", keys[i]);
+        bench_record ("us", false, t_free * 1e6 / n_instances,  "startup.%s.free", keys[i]);
+    }
+
+    /* deferred init: paid by first unknown command */
+    TclLN instance = tclln_new_with_options (NULL, TCLLN_LAZY_INIT);
+
+    const char *script = "catch {tclln_bench_unknown}";
+    double t_start = time_now ();
+    tclln_run_buffer (instance, script, strlen (script));
+    double t_unknown = time_now () - t_start;
+
+    tclln_free (instance);
+
+    printf ("  first unknown command with lazy init: %.1f\n", t_unknown * 1e6);
+    bench_record ("us", false, t_unknown * 1e6, "startup.lazy_init.first_unknown");
+
+    /* clock is auto-loaded by the init library: must work as first command with lazy init */
+    char dir [] = "/tmp/tclln_bench_XXXXXX";
+    if (mkdtemp (dir) == NULL) {
+        fprintf (stderr, "Error: could not create temporary directory\n");
+        return;
+    }
+
+    GString *clock_script = g_string_new ("if {[clock format 0 -gmt 1 -format %Y] ne \"1970\"} {exit 1}\n");
+    char *path = bench_write_temp (dir, "clock", clock_script);
+    g_string_free (clock_script, true);
+
+    if (path != NULL) {
+        instance = tclln_new_with_options (NULL, TCLLN_LAZY_INIT);
+
+        const char *paths [] = {path};
+        int status = 0;
+        tclln_run_files_parallel (instance, paths, 1, 1, &status);
+
+        tclln_free (instance);
+        g_free (path);
+
+        if (status != 0) {
+            fprintf (stderr, "Error: startup.lazy_init: clock format as first command failed\n");
+            bench_failures++;
+        }
+    }
+
+    bench_remove_dir (dir);
+}
+
+static void bench_pool (TclLN tclln)
+{
+    const int n_instances = 20;
+
+    printf ("new interpreter (us per instance):\n");
+
+    /* plain initialization */
+    double t_start = time_now ();
+    for (int i = 0; i < n_instances; i++) {
+        tclln_free (tclln_new (NULL));
+    }
+    double t_new = time_now () - t_start;
+
+    /* pool: acquire, refill while idle */
+    TclLNPool pool = tclln_pool_new (tclln, 4);
+
+    double t_acquire = 0;
+    for (int i = 0; i < n_instances; i++) {
+        t_start = time_now ();
+        TclLN instance = tclln_pool_acquire (pool);
+        t_acquire += time_now () - t_start;
+
+        tclln_free (instance);
+
+        while (Tcl_DoOneEvent (TCL_IDLE_EVENTS | TCL_DONT_WAIT)) {}
+    }
+
+    unsigned long acquires, misses, latency_avg, latency_max;
+    tclln_pool_stats (pool, &acquires, &misses, &latency_avg, &latency_max);
+
+    tclln_pool_free (pool);
+
+    printf ("  %-16s %10.1f\n", "tclln_new", t_new * 1e6 / n_instances);
+    printf ("  %-16s %10.1f (misses: %lu, max: %.1f)\n", "pool acquire", t_acquire * 1e6 / n_instances,
+            misses, latency_max * 1e-3);
+
+    bench_record ("us", false, t_acquire * 1e6 / n_instances, "pool.acquire");
+}
+
+static int bench_nop_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    return TCL_OK;
+}
+
+/* overhead of TCLLN_PROFILE_COMMANDS */
+static void bench_command_profile (void)
+{
+    const int  n_calls = 10000000;
+    const char *script = "proc bench_calls {n} {for {set i 0} {$i < $n} {incr i} {bench_nop}}";
+
+    const int options [] = {0, TCLLN_PROFILE_COMMANDS};
+    double    t_call [2];
+
+    printf ("custom command call (ns per call):\n");
+
+    for (size_t i = 0; i < G_N_ELEMENTS (options); i++) {
+        TclLN instance = tclln_new_with_options (NULL, options[i]);
+        tclln_add_command (instance, "bench_nop", NULL, bench_nop_command, NULL, NULL);
+        tclln_run_buffer (instance, script, strlen (script));
+
+        char call [64];
+        snprintf (call, sizeof (call), "bench_calls %d", n_calls);
+
+        double t_start = time_now ();
+        tclln_run_buffer (instance, call, strlen (call));
+        t_call[i] = time_now () - t_start;
+
+        tclln_free (instance);
+    }
+
+    printf ("  %-16s %10.1f\n", "plain", t_call[0] * 1e9 / n_calls);
+    printf ("  %-16s %10.1f (overhead: %.1f)\n", "profiled", t_call[1] * 1e9 / n_calls,
+            (t_call[1] - t_call[0]) * 1e9 / n_calls);
+
+    bench_record ("ns", false, t_call[0] * 1e9 / n_calls, "command_call.plain");
+    bench_record ("ns", false, t_call[1] * 1e9 / n_calls, "command_call.profiled");
+}
+
+/* completion with many commands, variables, arguments and directory entries */
+static void bench_completion (void)
+{
+    const int n_entries = 10000;
+    const int n_repeat  = 20;
+
+    char dir [] = "/tmp/tclln_bench_XXXXXX";
+    if (mkdtemp (dir) == NULL) {
+        fprintf (stderr, "Error: could not create temporary directory\n");
+        return;
+    }
+
+    TclLN instance = tclln_new (NULL);
+
+    /* procs and variables */
+    char *script = g_strdup_printf ("for {set i 0} {$i < %d} {incr i} {\n"
+                                    "    proc bench_cmd_[format %%05d $i] {} {}\n"
+                                    "    set ::bench_var_[format %%05d $i] $i\n"
+                                    "}", n_entries);
+    tclln_run_buffer (instance, script, strlen (script));
+    g_free (script);
+
+    /* command with many arguments */
+    char **args = g_new0 (char *, n_entries + 1);
+    for (int i = 0; i < n_entries; i++) {
+        args[i] = g_strdup_printf ("-option_%05d", i);
+    }
+    tclln_add_command (instance, "bench_args", (const char * const *) args, bench_nop_command, NULL, NULL);
+    g_strfreev (args);
+
+    /* directory entries */
+    for (int i = 0; i < n_entries; i++) {
+        char *path = g_strdup_printf ("%s/file_%05d", dir, i);
+        int fd = open (path, O_WRONLY | O_CREAT, 0644);
+        if (fd >= 0) close (fd);
+        g_free (path);
+    }
+
+    char *file_input = g_strdup_printf ("open %s/file_00", dir);
+
+    char *fuzzy_file_input = g_strdup_printf ("open %s/f0012", dir);
+
+    const char *names  [] = {"commands",       "commands_all", "variables",          "arguments",              "files",
+                             "fuzzy_commands", "fuzzy_variables",    "fuzzy_arguments",      "fuzzy_files"};
+    const char *inputs [] = {"bench_cmd_00",   "bench_cmd_",   "puts $bench_var_00", "bench_args -option_00",  file_input,
+                             "bc0012",         "puts $bv0012",       "bench_args -o0012",    fuzzy_file_input};
+    const bool fuzzy   [] = {false,            false,          false,                false,                    false,
+                             true,             true,                 true,                   true};
+
+    printf ("completion with %d entries (us per completion):\n", n_entries);
+    printf ("  %-16s %10s %10s\n", "input", "matches", "time");
+
+    for (size_t i = 0; i < G_N_ELEMENTS (inputs); i++) {
+        int n_matches = 0;
+
+        tclln_set_fuzzy_completion (instance, fuzzy[i]);
+
+        double t_start = time_now ();
+        for (int j = 0; j < n_repeat; j++) {
+            char **completions = tclln_complete (instance, inputs[i]);
+
+            n_matches = (completions == NULL ? 0 : g_strv_length (completions));
+            tclln_free_completions (completions);
+        }
+        double t_complete = time_now () - t_start;
+
+        printf ("  %-16s %10d %10.1f\n", names[i], n_matches, t_complete * 1e6 / n_repeat);
+        bench_record ("us", false, t_complete * 1e6 / n_repeat, "completion.%s", names[i]);
+    }
+
+    g_free (file_input);
+    g_free (fuzzy_file_input);
+    tclln_free (instance);
+    bench_remove_dir (dir);
+
+    /* fuzzy completion gathers the commands of all namespaces - the first completion builds the index */
+    const int n_namespaces = 1000;
+
+    instance = tclln_new (NULL);
+    tclln_set_fuzzy_completion (instance, true);
+
+    script = g_strdup_printf ("for {set n 0} {$n < %d} {incr n} {\n"
+                              "    namespace eval bench_ns_$n {for {set i 0} {$i < 100} {incr i} {proc cmd_${i}_item {} {}}}\n"
+                              "}", n_namespaces);
+    tclln_run_buffer (instance, script, strlen (script));
+    g_free (script);
+
+    const char *ns_names  [] = {"fuzzy_ns_first", "fuzzy_ns",  "fuzzy_ns_all"};
+    const char *ns_inputs [] = {"bn5c12",         "bn5c12",    "item"};
+    const int  ns_repeat  [] = {1,                n_repeat,    n_repeat};
+
+    printf ("fuzzy completion with %d commands in %d namespaces (us per completion):\n", n_namespaces * 100, n_namespaces);
+    printf ("  %-16s %10s %10s\n", "input", "matches", "time");
+
+    for (size_t i = 0; i < G_N_ELEMENTS (ns_inputs); i++) {
+        int n_matches = 0;
+
+        double t_start = time_now ();
+        for (int j = 0; j < ns_repeat[i]; j++) {
+            char **completions = tclln_complete (instance, ns_inputs[i]);
+
+            n_matches = (completions == NULL ? 0 : g_strv_length (completions));
+            tclln_free_completions (completions);
+        }
+        double t_complete = time_now () - t_start;
+
+        printf ("  %-16s %10d %10.1f\n", ns_names[i], n_matches, t_complete * 1e6 / ns_repeat[i]);
+        bench_record ("us", false, t_complete * 1e6 / ns_repeat[i], "completion.%s", ns_names[i]);
+    }
+
+    tclln_free (instance);
+}
+
+/* generated script of given shape with about n_lines lines */
+static GString *run_file_script (const char *shape, int n_lines)
+{
+    GString *script = g_string_new (NULL);
+
+    if (strcmp (shape, "flat") == 0) {
+        /* simple top-level commands */
+        for (int i = 0; i < n_lines; i++) {
+            g_string_append_printf (script, "set v(%d) %d\n", i, i);
+        }
+    } else if (strcmp (shape, "procs") == 0) {
+        /* definition and call of many procs */
+        for (int i = 0; i < n_lines / 2; i++) {
+            g_string_append_printf (script, "proc p%d {a} {return [expr {$a + %d}]}\n", i, i);
+            g_string_append_printf (script, "p%d %d\n", i, i);
+        }
+    } else if (strcmp (shape, "nested") == 0) {
+        /* multi-line commands with nested bodies */
+        for (int i = 0; i < n_lines / 5; i++) {
+            g_string_append_printf (script, "if {%d >= 0} {\n"
+                                            "    foreach x {1 2 3} {\n"
+                                            "        set y($x) %d\n"
+                                            "    }\n"
+                                            "}\n", i, i);
+        }
+    } else if (strcmp (shape, "long_lines") == 0) {
+        /* commands with many words */
+        for (int i = 0; i < n_lines; i++) {
+            g_string_append (script, "list");
+            for (int j = 0; j < 100; j++) {
+                g_string_append_printf (script, " e%d", j);
+            }
+            g_string_append_c (script, '\n');
+        }
+    }
+
+    return script;
+}
+
+/* tclln_run_file on scripts of different shapes */
+static void bench_run_file (void)
+{
+    const char *shapes [] = {"flat", "procs", "nested", "long_lines"};
+    const int  n_lines    = 100000;
+
+    char dir [] = "/tmp/tclln_bench_XXXXXX";
+    if (mkdtemp (dir) == NULL) {
+        fprintf (stderr, "Error: could not create temporary directory\n");
+        return;
+    }
+
+    printf ("tclln_run_file (lines/s):\n");
+    printf ("  %-12s %14s %14s\n", "shape", "whole", "verbose");
+
+    for (size_t i = 0; i < G_N_ELEMENTS (shapes); i++) {
+        GString *script = run_file_script (shapes[i], (strcmp (shapes[i], "long_lines") == 0 ? n_lines / 10 : n_lines));
+        char *path = bench_write_temp (dir, shapes[i], script);
+
+        int lines = 0;
+        for (size_t j = 0; j < script->len; j++) {
+            if (script->str[j] == '\n') lines++;
+        }
+        g_string_free (script, true);
+
+        if (path == NULL) continue;
+
+        /* whole file, then command by command with printed results - fresh instance each (no cached script) */
+        double t_run [2];
+
+        fflush (stdout);
+        int saved_stdout = dup (STDOUT_FILENO);
+        int null_fd      = open ("/dev/null", O_WRONLY);
+        dup2 (null_fd, STDOUT_FILENO);
+
+        for (int verbose = 0; verbose < 2; verbose++) {
+            TclLN instance = tclln_new (NULL);
+
+            double t_start = time_now ();
+            tclln_run_file (instance, path, verbose);
+            t_run[verbose] = time_now () - t_start;
+
+            tclln_free (instance);
+        }
+
+        fflush (stdout);
+        dup2 (saved_stdout, STDOUT_FILENO);
+        close (saved_stdout);
+        close (null_fd);
+
+        printf ("  %-12s %14.0f %14.0f\n", shapes[i], lines / t_run[0], lines / t_run[1]);
+        bench_record ("lines/s", true, lines / t_run[0], "run_file.%s.whole", shapes[i]);
+        bench_record ("lines/s", true, lines / t_run[1], "run_file.%s.verbose", shapes[i]);
+
+        /* printing results costs time: running quietly must not be slower */
+        char *whole   = g_strdup_printf ("run_file.%s.whole", shapes[i]);
+        char *verbose = g_strdup_printf ("run_file.%s.verbose", shapes[i]);
+        bench_expect_not_worse (whole, verbose);
+        g_free (whole);
+        g_free (verbose);
+
+        g_free (path);
+    }
+
+    bench_remove_dir (dir);
+}
+
+/* linenoiseHistoryAdd with full history of different sizes */
+static void bench_history (void)
+{
+    const int sizes [] = {1000, 10000, 100000};
+
+    printf ("linenoiseHistoryAdd with full history (ns per line):\n");
+
+    for (size_t i = 0; i < G_N_ELEMENTS (sizes); i++) {
+        int n_lines = 2 * sizes[i];
+
+        char **lines = g_new (char *, n_lines);
+        for (int j = 0; j < n_lines; j++) {
+            lines[j] = g_strdup_printf ("set x(%d) [list a b c]", j);
+        }
+
+        linenoiseHistorySetMaxLen (sizes[i]);
+
+        /* fill, then measure adds that drop the oldest line */
+        for (int j = 0; j < sizes[i]; j++) {
+            linenoiseHistoryAdd (lines[j]);
+        }
+
+        double t_start = time_now ();
+        for (int j = sizes[i]; j < n_lines; j++) {
+            linenoiseHistoryAdd (lines[j]);
+        }
+        double t_add = time_now () - t_start;
+
+        for (int j = 0; j < n_lines; j++) {
+            g_free (lines[j]);
+        }
+        g_free (lines);
+
+        printf ("  %8d %10.1f\n", sizes[i], t_add * 1e9 / sizes[i]);
+        bench_record ("ns", false, t_add * 1e9 / sizes[i], "history_add.%d", sizes[i]);
+    }
+
+    linenoiseHistorySetMaxLen (100);
+}
+
+/* read everything written to the terminal - returns number of bytes */
+static size_t pty_drain (int master_fd)
+{
+    char   buffer [4096];
+    size_t n_total = 0;
+
+    while (true) {
+        ssize_t n_read = read (master_fd, buffer, sizeof (buffer));
+        if (n_read <= 0) break;
+        n_total += n_read;
+    }
+
+    return n_total;
+}
+
+/* refresh of edited line - cursor is moved left and right on a pseudo terminal */
+static void bench_refresh (void)
+{
+    const int lengths [] = {80, 1000, 4000};
+    const int n_moves    = 2000;
+
+    int master_fd = posix_openpt (O_RDWR | O_NOCTTY);
+    if ((master_fd < 0) || (grantpt (master_fd) != 0) || (unlockpt (master_fd) != 0)) {
+        fprintf (stderr, "Error: could not open pseudo terminal\n");
+        if (master_fd >= 0) close (master_fd);
+        return;
+    }
+
+    int slave_fd = open (ptsname (master_fd), O_RDWR | O_NOCTTY);
+    if (slave_fd < 0) {
+        fprintf (stderr, "Error: could not open pseudo terminal\n");
+        close (master_fd);
+        return;
+    }
+
+    struct winsize window_size = {.ws_row = 50, .ws_col = 80};
+    ioctl (slave_fd, TIOCSWINSZ, &window_size);
+    fcntl (master_fd, F_SETFL, O_NONBLOCK);
+
+    /* linenoise expects the terminal on stdin/stdout */
+    fflush (stdout);
+    int saved_stdin  = dup (STDIN_FILENO);
+    int saved_stdout = dup (STDOUT_FILENO);
+    dup2 (slave_fd, STDIN_FILENO);
+    dup2 (slave_fd, STDOUT_FILENO);
+
+    const char *modes [] = {"single", "multi"};
+    double t_refresh [2][G_N_ELEMENTS (lengths)];
+    double n_bytes   [2][G_N_ELEMENTS (lengths)];
+    bool   success = true;
+
+    for (int mode = 0; (mode < 2) && success; mode++) {
+        linenoiseSetMultiLine (mode);
+
+        for (size_t i = 0; i < G_N_ELEMENTS (lengths); i++) {
+            /* long line is recalled from history */
+            char *line = g_malloc (lengths[i] + 1);
+            for (int j = 0; j < lengths[i]; j++) {
+                line[j] = 'a' + (j % 26);
+            }
+            line[lengths[i]] = '\0';
+            linenoiseHistoryAdd (line);
+            g_free (line);
+
+            struct linenoiseState state;
+            if (linenoiseEditStart (&state, STDIN_FILENO, STDOUT_FILENO, "bench> ") != 0) {
+                success = false;
+                break;
+            }
+
+            const char history_prev = 16;   /* ctrl-p */
+            if (write (master_fd, &history_prev, 1) == 1) linenoiseEditFeed (&state);
+            pty_drain (master_fd);
+
+            t_refresh[mode][i] = 0;
+            n_bytes[mode][i]   = 0;
+
+            for (int j = 0; j < n_moves; j++) {
+                const char key = ((j % 2) == 0 ? 2 : 6);   /* ctrl-b, ctrl-f */
+                if (write (master_fd, &key, 1) != 1) break;
+
+                double t_start = time_now ();
+                linenoiseEditFeed (&state);
+                t_refresh[mode][i] += time_now () - t_start;
+
+                n_bytes[mode][i] += pty_drain (master_fd);
+            }
+
+            /* enter: finish line */
+            const char enter = 13;
+            if (write (master_fd, &enter, 1) == 1) linenoiseFree (linenoiseEditFeed (&state));
+            linenoiseEditStop (&state);
+            pty_drain (master_fd);
+        }
+    }
+
+    fflush (stdout);
+    dup2 (saved_stdin,  STDIN_FILENO);
+    dup2 (saved_stdout, STDOUT_FILENO);
+    close (saved_stdin);
+    close (saved_stdout);
+    close (slave_fd);
+    close (master_fd);
+
+    if (!success) {
+        fprintf (stderr, "Error: line editing not supported by terminal\n");
+        return;
+    }
+
+    printf ("line refresh on 80 column terminal (us and bytes per refresh):\n");
+    printf ("  %-8s %8s %10s %10s\n", "mode", "length", "time", "bytes");
+
+    for (int mode = 0; mode < 2; mode++) {
+        for (size_t i = 0; i < G_N_ELEMENTS (lengths); i++) {
+            printf ("  %-8s %8d %10.2f %10.0f\n", modes[mode], lengths[i],
+                    t_refresh[mode][i] * 1e6 / n_moves, n_bytes[mode][i] / n_moves);
+            bench_record ("us", false, t_refresh[mode][i] * 1e6 / n_moves, "refresh.%s.%d", modes[mode], lengths[i]);
+            bench_record ("bytes", false, n_bytes[mode][i] / n_moves, "refresh.%s.%d.bytes", modes[mode], lengths[i]);
+        }
+    }
+}
+
+/* shell running on a pseudo terminal - driven by bench_keystrokes */
+struct pty_shell {
+    pid_t pid;
+    int   master_fd;
+};
+
+/* start shell in child process with the slave side as controlling terminal */
+static bool pty_shell_start (struct pty_shell *shell, bool single_row)
+{
+    shell->master_fd = posix_openpt (O_RDWR | O_NOCTTY);
+    if ((shell->master_fd < 0) || (grantpt (shell->master_fd) != 0) || (unlockpt (shell->master_fd) != 0)) {
+        fprintf (stderr, "Error: could not open pseudo terminal\n");
+        if (shell->master_fd >= 0) close (shell->master_fd);
+        return false;
+    }
+
+    char *slave_name = g_strdup (ptsname (shell->master_fd));
+
+    fflush (stdout);
+    fflush (stderr);
+
+    shell->pid = fork ();
+    if (shell->pid < 0) {
+        close (shell->master_fd);
+        g_free (slave_name);
+        return false;
+    }
+
+    if (shell->pid == 0) {
+        /* child: new session, terminal of 80 columns on stdin/stdout/stderr */
+        setsid ();
+        int slave_fd = open (slave_name, O_RDWR);
+        if (slave_fd < 0) _exit (1);
+
+        struct winsize window_size = {.ws_row = 50, .ws_col = 80};
+        ioctl (slave_fd, TIOCSWINSZ, &window_size);
+
+        dup2 (slave_fd, STDIN_FILENO);
+        dup2 (slave_fd, STDOUT_FILENO);
+        dup2 (slave_fd, STDERR_FILENO);
+        close (slave_fd);
+        close (shell->master_fd);
+
+        setenv ("TERM", "xterm", 1);
+
+        TclLN instance = tclln_new (NULL);
+        if (instance == NULL) _exit (1);
+
+        tclln_set_single_row (instance, single_row);
+        tclln_set_prompt (instance, "bench> ", "     : ");
+        tclln_run (instance);
+        tclln_free (instance);
+
+        _exit (0);
+    }
+
+    g_free (slave_name);
+    fcntl (shell->master_fd, F_SETFL, O_NONBLOCK);
+
+    return true;
+}
+
+/* end shell by ctrl-d on an empty line */
+static void pty_shell_stop (struct pty_shell *shell)
+{
+    const char keys [] = {21, 4};   /* ctrl-u, ctrl-d */
+    if (write (shell->master_fd, keys, sizeof (keys)) != sizeof (keys)) kill (shell->pid, SIGKILL);
+
+    /* wait up to 2 s */
+    int status;
+    for (int i = 0; i < 200; i++) {
+        if (waitpid (shell->pid, &status, WNOHANG) == shell->pid) {
+            close (shell->master_fd);
+            return;
+        }
+        pty_drain (shell->master_fd);
+        g_usleep (10000);
+    }
+
+    kill (shell->pid, SIGKILL);
+    waitpid (shell->pid, &status, 0);
+    close (shell->master_fd);
+}
+
+/* write keys and read the output they cause - it is complete when the terminal is quiet for quiet_ms
+ * returns time from writing the keys to the last byte of output in s, adds number of bytes to n_bytes */
+static double pty_keys (struct pty_shell *shell, const char *keys, size_t length, int quiet_ms, size_t *n_bytes)
+{
+    char buffer [4096];
+
+    double t_start = time_now ();
+    double t_last  = t_start;
+
+    if (write (shell->master_fd, keys, length) != (ssize_t) length) return 0;
+
+    /* first output may take long, e.g. for commands */
+    int timeout_ms = 2000;
+
+    while (true) {
+        struct pollfd poll_fd = {.fd = shell->master_fd, .events = POLLIN};
+        if (poll (&poll_fd, 1, timeout_ms) <= 0) break;
+
+        ssize_t n_read = read (shell->master_fd, buffer, sizeof (buffer));
+        if (n_read <= 0) break;
+
+        t_last = time_now ();
+        if (n_bytes != NULL) *n_bytes += n_read;
+
+        timeout_ms = quiet_ms;
+    }
+
+    return t_last - t_start;
+}
+
+/* keystroke stream of one scenario - latency and output per keystroke */
+struct keystroke_stats {
+    int    n_keys;
+    double t_sum;
+    double t_max;
+    size_t n_bytes;
+};
+
+static void keystroke_measure (struct pty_shell *shell, struct keystroke_stats *stats, const char *keys, size_t length,
+                size_t n_keys)
+{
+    double t_keys = pty_keys (shell, keys, length, 2, &stats->n_bytes);
+
+    stats->n_keys += n_keys;
+    stats->t_sum  += t_keys;
+    if (t_keys / n_keys > stats->t_max) stats->t_max = t_keys / n_keys;
+}
+
+/* keystroke latency of the shell on a pseudo terminal: typing, paste, tab cycling and history scrolling
+ * in multi and single row mode - latency is the time from writing the keys until the output is complete */
+static void bench_keystrokes (void)
+{
+    const char *modes [] = {"multi", "single"};
+    const char *scenarios [] = {"typing", "paste", "tab", "history"};
+
+    const int line_length  = 200;
+    const int paste_length = 2000;
+    const int n_tabs       = 50;
+    const int n_history    = 100;
+
+    struct keystroke_stats stats [2][G_N_ELEMENTS (scenarios)];
+    memset (stats, 0, sizeof (stats));
+
+    const char clear_line = 21;     /* ctrl-u */
+
+    for (int mode = 0; mode < 2; mode++) {
+        struct pty_shell shell;
+        if (!pty_shell_start (&shell, (mode == 1))) return;
+
+        /* prompt */
+        pty_keys (&shell, "", 0, 100, NULL);
+
+        /* typing: long line key by key */
+        for (int i = 0; i < line_length; i++) {
+            const char key = 'a' + (i % 26);
+            keystroke_measure (&shell, &stats[mode][0], &key, 1, 1);
+        }
+        pty_keys (&shell, &clear_line, 1, 10, NULL);
+
+        /* paste: burst of keys written at once */
+        char *paste = g_malloc (paste_length);
+        for (int i = 0; i < paste_length; i++) {
+            paste[i] = 'a' + (i % 26);
+        }
+        keystroke_measure (&shell, &stats[mode][1], paste, paste_length, paste_length);
+        pty_keys (&shell, &clear_line, 1, 10, NULL);
+        g_free (paste);
+
+        /* tab: cycle through completions of commands */
+        pty_keys (&shell, "l", 1, 10, NULL);
+        for (int i = 0; i < n_tabs; i++) {
+            keystroke_measure (&shell, &stats[mode][2], "\t", 1, 1);
+        }
+        const char cancel_completion = 3;   /* ctrl-c */
+        pty_keys (&shell, &cancel_completion, 1, 10, NULL);
+        pty_keys (&shell, &clear_line, 1, 10, NULL);
+
+        /* history: enter commands, scroll back */
+        for (int i = 0; i < n_history; i++) {
+            char *command = g_strdup_printf ("set h%d {%0*d}\r", i, 100, i);
+            pty_keys (&shell, command, strlen (command), 10, NULL);
+            g_free (command);
+        }
+        for (int i = 0; i < n_history; i++) {
+            keystroke_measure (&shell, &stats[mode][3], "\x1b[A", 3, 1);
+        }
+
+        pty_shell_stop (&shell);
+    }
+
+    printf ("keystrokes on pseudo terminal (us and bytes per key):\n");
+    printf ("  %-8s %-10s %8s %10s %10s %10s\n", "mode", "scenario", "keys", "mean", "max", "bytes");
+
+    for (int mode = 0; mode < 2; mode++) {
+        for (size_t i = 0; i < G_N_ELEMENTS (scenarios); i++) {
+            struct keystroke_stats *s = &stats[mode][i];
+            if (s->n_keys == 0) continue;
+
+            printf ("  %-8s %-10s %8d %10.1f %10.1f %10.1f\n", modes[mode], scenarios[i], s->n_keys,
+                    s->t_sum * 1e6 / s->n_keys, s->t_max * 1e6, (double) s->n_bytes / s->n_keys);
+
+            bench_record ("us",    false, s->t_sum * 1e6 / s->n_keys,          "keystrokes.%s.%s", modes[mode], scenarios[i]);
+            bench_record ("us",    false, s->t_max * 1e6,                      "keystrokes.%s.%s.max", modes[mode], scenarios[i]);
+            bench_record ("bytes", false, (double) s->n_bytes / s->n_keys,     "keystrokes.%s.%s.bytes", modes[mode], scenarios[i]);
+        }
+    }
+}
+
+/* write results as json */
+static bool bench_write_json (const char *file_name)
+{
+    FILE *file = fopen (file_name, "w");
+    if (file == NULL) {
+        fprintf (stderr, "Error: could not write %s\n", file_name);
+        return false;
+    }
+
+    fprintf (file, "{\n  \"results\": [\n");
+
+    for (guint i = 0; i < bench_results->len; i++) {
+        struct bench_result *result = &g_array_index (bench_results, struct bench_result, i);
+
+        /* one result per line - read back by bench_read_baseline */
+        fprintf (file, "    {\"name\": \"%s\", \"value\": %.6g, \"min\": %.6g, \"max\": %.6g, \"samples\": %u, \"spread\": %.1f, "
+                       "\"unit\": \"%s\", \"better\": \"%s\"}%s\n",
+                 result->name, result->value, result->min, result->max, result->samples->len, bench_spread (result),
+                 result->unit, (result->higher_is_better ? "higher" : "lower"), (i + 1 < bench_results->len ? "," : ""));
+    }
+
+    fprintf (file, "  ]\n}\n");
+
+    return (fclose (file) == 0);
+}
+
+/* read results of json written by bench_write_json */
+static bool bench_read_baseline (const char *file_name)
+{
+    FILE *file = fopen (file_name, "r");
+    if (file == NULL) {
+        fprintf (stderr, "Error: could not read %s\n", file_name);
+        return false;
+    }
+
+    bench_baseline = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+    char line [1024];
+    while (fgets (line, sizeof (line), file) != NULL) {
+        const char *name_pos   = strstr (line, "\"name\":");
+        const char *value_pos  = strstr (line, "\"value\":");
+        const char *spread_pos = strstr (line, "\"spread\":");
+        if ((name_pos == NULL) || (value_pos == NULL)) continue;
+
+        char   name [512];
+        struct bench_baseline_value *value = g_new0 (struct bench_baseline_value, 1);
+
+        if ((sscanf (name_pos, "\"name\": \"%511[^\"]\"", name) != 1) ||
+            (sscanf (value_pos, "\"value\": %lf", &value->value) != 1)) {
+            g_free (value);
+            continue;
+        }
+
+        /* written by older versions without repetitions */
+        if ((spread_pos == NULL) || (sscanf (spread_pos, "\"spread\": %lf", &value->spread) != 1)) {
+            value->spread = 0;
+        }
+
+        g_hash_table_replace (bench_baseline, g_strdup (name), value);
+    }
+
+    fclose (file);
+
+    return true;
+}
+
+/* compare medians against baseline - returns number of regressions
+ * a change is a regression if it exceeds the threshold and the spread of the samples of both runs */
+static int bench_compare (double threshold_percent)
+{
+    int n_regressions = 0;
+
+    printf ("comparison against baseline (threshold %.1f%%):\n", threshold_percent);
+    printf ("  %-36s %14s %14s %9s %8s\n", "name", "baseline", "current", "change", "spread");
+
+    for (guint i = 0; i < bench_results->len; i++) {
+        struct bench_result *result = &g_array_index (bench_results, struct bench_result, i);
+
+        struct bench_baseline_value *baseline = g_hash_table_lookup (bench_baseline, result->name);
+        if ((baseline == NULL) || (baseline->value == 0)) continue;
+
+        double change = (result->value - baseline->value) * 100 / baseline->value;
+        double spread = MAX (bench_spread (result), baseline->spread);
+        double loss   = (result->higher_is_better ? -change : change);
+        bool   worse  = (loss > threshold_percent) && (loss > spread);
+
+        if (worse) n_regressions++;
+
+        printf ("  %-36s %14.6g %14.6g %+8.1f%% %7.1f%% %s\n", result->name, baseline->value, result->value, change, spread,
+                (worse ? "REGRESSION" : ""));
+    }
+
+    printf ("  %d regressions\n", n_regressions);
+
+    return n_regressions;
+}
+
+static void usage (const char *prog_name)
+{
+    fprintf (stderr, "usage: %s [-o results.json] [-c baseline.json] [-t threshold_percent] [-r repetitions] [-b benchmark]\n", prog_name);
+    fprintf (stderr, "  benchmarks: multiline pipe_input startup pool command_call completion run_file history refresh keystrokes\n");
+}
+
+int main (int argc, const char *argv[])
+{
+    const char *output_file   = NULL;
+    const char *baseline_file = NULL;
+    double     threshold      = 10;
+    int        repetitions    = 5;
+
+    for (int i = 1; i < argc; i++) {
+        if ((i + 1 < argc) && (strcmp (argv[i], "-o") == 0)) {
+            output_file = argv[++i];
+        } else if ((i + 1 < argc) && (strcmp (argv[i], "-c") == 0)) {
+            baseline_file = argv[++i];
+        } else if ((i + 1 < argc) && (strcmp (argv[i], "-t") == 0)) {
+            threshold = atof (argv[++i]);
+        } else if ((i + 1 < argc) && (strcmp (argv[i], "-r") == 0)) {
+            repetitions = atoi (argv[++i]);
+            if (repetitions < 1) repetitions = 1;
+        } else if ((i + 1 < argc) && (strcmp (argv[i], "-b") == 0)) {
+            bench_selected = argv[++i];
+        } else {
+            usage (argv[0]);
+            return 1;
+        }
+    }
+
+    bench_results      = g_array_new (false, false, sizeof (struct bench_result));
+    bench_result_index = g_hash_table_new (g_str_hash, g_str_equal);
+    bench_checks       = g_ptr_array_new_with_free_func (bench_check_free);
+
+    if ((baseline_file != NULL) && !bench_read_baseline (baseline_file)) return 1;
+
+    TclLN tclln = tclln_new (argv[0]);
+    if (tclln == NULL) return 1;
+
+    /* single measurements are noisy: results are medians of all repetitions */
+    for (bench_repetition = 0; bench_repetition < repetitions; bench_repetition++) {
+        /* tables of the first repetition are printed */
+        int saved_stdout = -1;
+
+        if (bench_repetition > 0) {
+            fflush (stdout);
+            saved_stdout = dup (STDOUT_FILENO);
+
+            int null_fd = open ("/dev/null", O_WRONLY);
+            dup2 (null_fd, STDOUT_FILENO);
+            close (null_fd);
+        }
+
+        if (bench_enabled ("multiline"))    bench_multiline_command (tclln);
+        if (bench_enabled ("pipe_input"))   bench_pipe_input (tclln);
+        if (bench_enabled ("startup"))      bench_startup ();
+        if (bench_enabled ("pool"))         bench_pool (tclln);
+        if (bench_enabled ("command_call")) bench_command_profile ();
+        if (bench_enabled ("completion"))   bench_completion ();
+        if (bench_enabled ("run_file"))     bench_run_file ();
+        if (bench_enabled ("history"))      bench_history ();
+        if (bench_enabled ("refresh"))      bench_refresh ();
+        if (bench_enabled ("keystrokes"))   bench_keystrokes ();
+
+        if (saved_stdout >= 0) {
+            fflush (stdout);
+            dup2 (saved_stdout, STDOUT_FILENO);
+            close (saved_stdout);
+        }
+    }
+
+    tclln_free (tclln);
+
+    bench_summarize ();
+    bench_run_checks ();
+
+    if (repetitions > 1) {
+        printf ("medians of %d repetitions:\n", repetitions);
+        printf ("  %-36s %14s %14s %14s %8s\n", "name", "median", "min", "max", "spread");
+
+        for (guint i = 0; i < bench_results->len; i++) {
+            struct bench_result *result = &g_array_index (bench_results, struct bench_result, i);
+
+            printf ("  %-36s %14.6g %14.6g %14.6g %7.1f%%\n", result->name, result->value, result->min, result->max,
+                    bench_spread (result));
+        }
+    }
+
+    int status = 0;
+
+    if ((output_file != NULL) && !bench_write_json (output_file)) status = 1;
+
+    if (bench_baseline != NULL) {
+        if (bench_compare (threshold) > 0) status = 2;
+        g_hash_table_destroy (bench_baseline);
+    }
+
+    if (bench_failures > 0) status = 2;
+
+    for (guint i = 0; i < bench_results->len; i++) {
+        struct bench_result *result = &g_array_index (bench_results, struct bench_result, i);
+
+        g_free (result->name);
+        g_array_free (result->samples, true);
+    }
+    g_array_free (bench_results, true);
+    g_hash_table_destroy (bench_result_index);
+    g_ptr_array_free (bench_checks, true);
+
+    return status;
+}
@@ -0,0 +1,45 @@
+/*
+ *    tclln is a library for integrating a tcl-shell with custom commands
+ *    Copyright (C) 2016  Andreas Dixius
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __COMPLETION_HASH_H__
+#define __COMPLETION_HASH_H__
+
+#include <stdint.h>
+
+/* hash of command names for the table of default completions
+ * shared by gen_completion (build time) and tclln (lookup)
+ *   name: command name
+ *   seed: seed found by gen_completion - makes the hash perfect for the default commands
+ * returns: hash value - use lowest bits as index
+ */
+static inline uint32_t completion_hash (const char *name, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+
+    for (const unsigned char *c = (const unsigned char *) name; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+
+    /* mix high bits into the index bits */
+    hash ^= hash >> 15;
+
+    return hash;
+}
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ *    tclln is a library for integrating a tcl-shell with custom commands
+ *    Copyright (C) 2016  Andreas Dixius
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* generates completion_defaults.h from completion_defaults.txt:
+ * sorted static argument arrays per command and a perfect hash over the command names */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#include "completion_hash.h"
+
+struct command {
+    char *name;
+    char **args;
+    int  n_args;
+};
+
+static struct command *commands   = NULL;
+static int            n_commands  = 0;
+
+static int compare_strings (const void *a, const void *b)
+{
+    return strcmp (*(char * const *) a, *(char * const *) b);
+}
+
+static int compare_commands (const void *a, const void *b)
+{
+    return strcmp (((const struct command *) a)->name, ((const struct command *) b)->name);
+}
+
+static void *checked_realloc (void *ptr, size_t size)
+{
+    ptr = realloc (ptr, size);
+    if (ptr == NULL) {
+        fprintf (stderr, "Error: out of memory\n");
+        exit (1);
+    }
+
+    return ptr;
+}
+
+/* add word of input: first word of an entry is the command name */
+static void add_word (struct command *command, const char *word, size_t len)
+{
+    char *copy = (char *) checked_realloc (NULL, len + 1);
+    memcpy (copy, word, len);
+    copy[len] = '\0';
+
+    if (command->name == NULL) {
+        command->name = copy;
+        return;
+    }
+
+    /* duplicate arguments are dropped */
+    for (int i = 0; i < command->n_args; i++) {
+        if (strcmp (command->args[i], copy) == 0) {
+            free (copy);
+            return;
+        }
+    }
+
+    command->args = (char **) checked_realloc (command->args, sizeof (char *) * (command->n_args + 1));
+    command->args[command->n_args++] = copy;
+}
+
+static bool read_input (FILE *input)
+{
+    char line [4096];
+    bool continued = false;
+
+    while (fgets (line, sizeof (line), input) != NULL) {
+        size_t len = strlen (line);
+        while ((len > 0) && isspace ((unsigned char) line[len-1])) len--;
+        line[len] = '\0';
+
+        /* comments and empty lines */
+        const char *pos = line;
+        while (isspace ((unsigned char) *pos)) pos++;
+
+        if ((!continued) && ((*pos == '#') || (*pos == '\0'))) continue;
+
+        bool continues = ((len > 0) && (line[len-1] == '\\'));
+        if (continues) line[--len] = '\0';
+
+        if (!continued) {
+            commands = (struct command *) checked_realloc (commands, sizeof (struct command) * (n_commands + 1));
+            commands[n_commands++] = (struct command) {NULL, NULL, 0};
+        }
+
+        struct command *command = &commands[n_commands-1];
+
+        while (*pos != '\0') {
+            const char *word_end = pos;
+            while ((*word_end != '\0') && (!isspace ((unsigned char) *word_end))) word_end++;
+
+            add_word (command, pos, word_end - pos);
+
+            pos = word_end;
+            while (isspace ((unsigned char) *pos)) pos++;
+        }
+
+        continued = continues;
+    }
+
+    qsort (commands, n_commands, sizeof (struct command), compare_commands);
+
+    for (int i = 0; i < n_commands; i++) {
+        if (commands[i].n_args == 0) {
+            fprintf (stderr, "Error: no arguments for command %s\n", commands[i].name);
+            return false;
+        }
+        if ((i > 0) && (strcmp (commands[i-1].name, commands[i].name) == 0)) {
+            fprintf (stderr, "Error: command %s is specified more than once\n", commands[i].name);
+            return false;
+        }
+
+        qsort (commands[i].args, commands[i].n_args, sizeof (char *), compare_strings);
+    }
+
+    return true;
+}
+
+/* find seed without collisions
+ * returns: true on success */
+static bool find_seed (int bits, uint32_t *seed, int *index)
+{
+    int size = 1 << bits;
+
+    for (uint32_t try_seed = 0; try_seed < 1000000; try_seed++) {
+        bool collision = false;
+
+        for (int i = 0; i < size; i++) index[i] = -1;
+
+        for (int i = 0; (i < n_commands) && (!collision); i++) {
+            uint32_t slot = completion_hash (commands[i].name, try_seed) & (size - 1);
+
+            if (index[slot] >= 0) collision = true;
+            index[slot] = i;
+        }
+
+        if (!collision) {
+            *seed = try_seed;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void write_output (FILE *output, int bits, uint32_t seed, const int *index)
+{
+    fprintf (output, "/* generated by gen_completion from completion_defaults.txt - do not edit */\n\n");
+
+    for (int i = 0; i < n_commands; i++) {
+        fprintf (output, "static const char * const default_args_%d [] = {", i);
+
+        for (int j = 0; j < commands[i].n_args; j++) {
+            fprintf (output, "%s\"%s\"", (j > 0 ? ", " : ""), commands[i].args[j]);
+        }
+
+        fprintf (output, "};\n");
+    }
+
+    fprintf (output, "\nstatic const struct default_completion default_completions [] = {\n");
+    for (int i = 0; i < n_commands; i++) {
+        fprintf (output, "    {\"%s\", default_args_%d, %d},\n", commands[i].name, i, commands[i].n_args);
+    }
+    fprintf (output, "};\n\n");
+
+    fprintf (output, "#define DEFAULT_COMPLETION_HASH_BITS %d\n\n", bits);
+    fprintf (output, "static const uint32_t default_completion_seed = %uu;\n\n", seed);
+
+    fprintf (output, "static const short default_completion_index [%d] = {", 1 << bits);
+    for (int i = 0; i < (1 << bits); i++) {
+        fprintf (output, "%s%d", ((i % 16) == 0 ? "\n    " : " "), index[i]);
+        if (i < (1 << bits) - 1) fprintf (output, ",");
+    }
+    fprintf (output, "\n};\n");
+}
+
+int main (int argc, const char *argv[])
+{
+    if (argc != 2) {
+        fprintf (stderr, "usage: %s <completion table>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *input = fopen (argv[1], "r");
+    if (input == NULL) {
+        fprintf (stderr, "Error: failed to open file %s\n", argv[1]);
+        return 1;
+    }
+
+    bool result = read_input (input);
+    fclose (input);
+
+    if (!result) return 1;
+
+    /* table with at most 50% load */
+    int bits = 1;
+    while ((1 << bits) < 2 * n_commands) bits++;
+
+    while (true) {
+        int      *index = (int *) checked_realloc (NULL, sizeof (int) * (1 << bits));
+        uint32_t seed;
+
+        if (find_seed (bits, &seed, index)) {
+            write_output (stdout, bits, seed, index);
+            free (index);
+            break;
+        }
+
+        free (index);
+        bits++;
+    }
+
+    return 0;
+}
@@ -132,6 +132,29 @@ static int history_max_len = LINENOISE_DEFAULT_HISTORY_MAX_LEN;
 static int history_len = 0;
 static char **history = NULL;
 
+/* Allocator of lines, history and completions, see linenoiseSetAllocator(). */
+static void *(*lnMalloc)(size_t) = malloc;
+static void *(*lnRealloc)(void *, size_t) = realloc;
+static void (*lnFree)(void *) = free;
+
+static char *lnStrdup(const char *s) {
+    size_t len = strlen(s)+1;
+    char *copy = lnMalloc(len);
+
+    if (copy == NULL) return NULL;
+    memcpy(copy,s,len);
+    return copy;
+}
+
+/* Set the functions used instead of malloc(), realloc() and free(). Has to
+ * be called before any other function of linenoise, as memory allocated
+ * before is released with the new free function. NULL keeps the default. */
+void linenoiseSetAllocator(void *(*malloc_fn)(size_t), void *(*realloc_fn)(void *, size_t), void (*free_fn)(void *)) {
+    lnMalloc = malloc_fn ? malloc_fn : malloc;
+    lnRealloc = realloc_fn ? realloc_fn : realloc;
+    lnFree = free_fn ? free_fn : free;
+}
+
 /* =========================== Append Buffer ================================= */
 
 /* We define a very simple "append buffer" structure, that is an heap
@@ -165,7 +188,7 @@ static void abAppend(struct abuf *ab, const char *s, int len) {
     if (ab->len + len + 1 > ab->blen) {
         if (ab->is_static) return;
         ab->blen = ab->blen+(((len>>AB_EXTENSION_EXP)+1)<<AB_EXTENSION_EXP);
-        char *new = realloc(ab->b,ab->blen);
+        char *new = lnRealloc(ab->b,ab->blen);
         if (new == NULL) {
             ab->b = NULL;
             ab->len = 0;
@@ -191,7 +214,7 @@ static void abReset(struct abuf *ab) {
 
 static void abFree(struct abuf *ab) {
     if (ab->is_static) return;
-    free(ab->b);
+    lnFree(ab->b);
     ab->b = NULL;
     ab->len = 0;
     ab->blen = 0;
@@ -242,21 +265,6 @@ static inline int utf8isstart (const char s)
 
 /* =========================== LineNoise ================================= */
 
-/* The linenoiseState structure represents the state during line editing.
- * We pass this state to functions implementing specific editing
- * functionalities. */
-struct linenoiseState {
-    int ifd;            /* Terminal stdin file descriptor. */
-    int ofd;            /* Terminal stdout file descriptor. */
-    struct abuf *ab;    /* Edited line buffer. */
-    const char *prompt; /* Prompt to display. */
-    size_t plen;        /* Prompt length. */
-    size_t pos;         /* Current cursor position. */
-    size_t oldpos;      /* Previous refresh cursor position. */
-    size_t cols;        /* Number of columns in terminal. */
-    size_t maxrows;     /* Maximum num of rows used so far (multiline mode) */
-    int history_index;  /* The history index we are currently editing. */
-};
 
 enum KEY_ACTION{
     KEY_NULL = 0,       /* NULL */
@@ -444,97 +452,100 @@ static void linenoiseBeep(void) {
 static void freeCompletions(linenoiseCompletions *lc) {
     size_t i;
     for (i = 0; i < lc->len; i++)
-        free(lc->cvec[i]);
+        lnFree(lc->cvec[i]);
     if (lc->cvec != NULL)
-        free(lc->cvec);
+        lnFree(lc->cvec);
 }
 
-/* This is an helper function for linenoiseEdit() and is called when the
+/* This is an helper function for linenoiseEditFeed() and is called when the
  * user types the <tab> key in order to complete the string currently in the
- * input.
+ * input, and for every key while in completion mode.
  *
  * The state of the editing is encapsulated into the pointed linenoiseState
- * structure as described in the structure definition. */
-static int completeLine(struct linenoiseState *ls, char *seq, int *seqread) {
+ * structure as described in the structure definition.
+ *
+ * Returns the character that should be handled next, or 0 if the key was
+ * consumed by completion, or -1 on read errors. */
+static int completeLine(struct linenoiseState *ls, char c, char *seq, int *seqread) {
     linenoiseCompletions lc = { 0, NULL };
-    int nread;
-    char c = 0;
 
     completionCallback(ls->ab->b,&lc);
     if (lc.len == 0) {
         linenoiseBeep();
-    } else {
-        size_t stop = 0, i = 0;
-
-        while(!stop) {
-            /* Show completion or original buffer */
-            if (i < lc.len) {
-                struct linenoiseState saved = *ls;
-                struct abuf ab;
-
-                ab.len = ls->pos = strlen(lc.cvec[i]);
-                ab.blen = ab.len;
-                ab.b = lc.cvec[i];
-                ab.is_static = 1;
-                ls->ab = &ab;
-                refreshLine(ls);
-                ls->ab = saved.ab;
-                ls->pos = saved.pos;
+        ls->in_completion = 0;
+        freeCompletions(&lc);
+        return (c == 9) ? 0 : c;
+    }
+
+    if (ls->completion_idx > lc.len) ls->completion_idx = lc.len;
+
+    switch(c) {
+        case 9: /* tab */
+            if (!ls->in_completion) {
+                ls->in_completion = 1;
+                ls->completion_idx = 0;
             } else {
-                refreshLine(ls);
+                ls->completion_idx = (ls->completion_idx+1) % (lc.len+1);
+                if (ls->completion_idx == lc.len) linenoiseBeep();
             }
-
-            nread = read(ls->ifd,&c,1);
-            if (nread <= 0) {
+            c = 0;
+            break;
+        case CTRL_C: /* ctrl-c */
+            /* Re-show original buffer */
+            ls->in_completion = 0;
+            c = 0;
+            break;
+        case ESC: /* escape sequence */
+            if ((read(ls->ifd,seq,1) == -1) || (read(ls->ifd,seq+1,1) == -1)) {
                 freeCompletions(&lc);
                 return -1;
             }
-
-            switch(c) {
-                case 9: /* tab */
-                    i = (i+1) % (lc.len+1);
-                    if (i == lc.len) linenoiseBeep();
-                    break;
-                case CTRL_C: /* ctrl-c */
-                    /* Re-show original buffer */
-                    if (i < lc.len) refreshLine(ls);
-                    stop = 1;
-                    c = 0;
-                    break;
-                case ESC: /* escape sequence */
-                    if ((read(ls->ifd,seq,1) == -1) || (read(ls->ifd,seq+1,1) == -1)) {
-                        freeCompletions(&lc);
-                        return -1;
-                    }
-                    if ((seq[0] == '[') && (seq[1] == 'Z')) {
-                        /* shift + tab */
-                        i = (i+lc.len) % (lc.len+1);
-                    } else {
-                        /* Update buffer and return with sequence */
-                        if (i < lc.len) {
-                            abReset(ls->ab);
-                            abAppend(ls->ab,lc.cvec[i],strlen(lc.cvec[i]));
-                            ls->pos = ls->ab->len;
-                        }
-                        *seqread = 1;
-                        stop = 1;
-                    }
-                    break;
-                default:
-                    /* Update buffer and return */
-                    if (i < lc.len) {
-                        abReset(ls->ab);
-                        abAppend(ls->ab,lc.cvec[i],strlen(lc.cvec[i]));
-                        ls->pos = ls->ab->len;
-                    }
-                    stop = 1;
-                    break;
+            if ((seq[0] == '[') && (seq[1] == 'Z')) {
+                /* shift + tab */
+                ls->completion_idx = (ls->completion_idx+lc.len) % (lc.len+1);
+                c = 0;
+            } else {
+                /* Update buffer and return with sequence */
+                if (ls->completion_idx < lc.len) {
+                    abReset(ls->ab);
+                    abAppend(ls->ab,lc.cvec[ls->completion_idx],strlen(lc.cvec[ls->completion_idx]));
+                    ls->pos = ls->ab->len;
+                }
+                ls->in_completion = 0;
+                *seqread = 1;
             }
-        }
+            break;
+        default:
+            /* Update buffer and return */
+            if (ls->completion_idx < lc.len) {
+                abReset(ls->ab);
+                abAppend(ls->ab,lc.cvec[ls->completion_idx],strlen(lc.cvec[ls->completion_idx]));
+                ls->pos = ls->ab->len;
+            }
+            ls->in_completion = 0;
+            break;
+    }
+
+    /* Show completion or original buffer */
+    if (ls->in_completion && ls->completion_idx < lc.len) {
+        struct abuf *saved_ab = ls->ab;
+        size_t saved_pos = ls->pos;
+        struct abuf ab;
+
+        ab.len = ls->pos = strlen(lc.cvec[ls->completion_idx]);
+        ab.blen = ab.len;
+        ab.b = lc.cvec[ls->completion_idx];
+        ab.is_static = 1;
+        ls->ab = &ab;
+        refreshLine(ls);
+        ls->ab = saved_ab;
+        ls->pos = saved_pos;
+    } else {
+        refreshLine(ls);
     }
 
     freeCompletions(&lc);
-    return c; /* Return last read character */
+    return c;
 }
 
 /* Register a callback function to be called for tab-completion. */
@@ -562,12 +573,12 @@ void linenoiseAddCompletion(linenoiseCompletions *lc, const char *str) {
     size_t len = strlen(str);
     char *copy, **cvec;
 
-    copy = malloc(len+1);
+    copy = lnMalloc(len+1);
     if (copy == NULL) return;
     memcpy(copy,str,len+1);
-    cvec = realloc(lc->cvec,sizeof(char*)*(lc->len+1));
+    cvec = lnRealloc(lc->cvec,sizeof(char*)*(lc->len+1));
     if (cvec == NULL) {
-        free(copy);
+        lnFree(copy);
         return;
     }
     lc->cvec = cvec;
@@ -819,8 +830,8 @@ void linenoiseEditHistoryNext(struct linenoiseState *l, int dir) {
     if (history_len > 1) {
         /* Update the current history entry before to
          * overwrite it with the next one. */
-        free(history[history_len - 1 - l->history_index]);
-        history[history_len - 1 - l->history_index] = strdup(l->ab->b);
+        lnFree(history[history_len - 1 - l->history_index]);
+        history[history_len - 1 - l->history_index] = lnStrdup(l->ab->b);
         /* Show the new entry */
         l->history_index += (dir == LINENOISE_HISTORY_PREV) ? 1 : -1;
         if (l->history_index < 0) {
@@ -882,202 +893,289 @@ void linenoiseEditDeletePrevWord(struct linenoiseState *l) {
     refreshLine(l);
 }
 
-/* This function is the core of the line editing capability of linenoise.
- * It expects 'fd' to be already in "raw mode" so that every key pressed
- * will be returned ASAP to read().
+/* This is a special buffer pointer returned by linenoiseEditFeed() while
+ * the line is still being edited. */
+char *linenoiseEditMore = "If you see this, you are misusing the API: when linenoiseEditFeed() is called, if it returns linenoiseEditMore the user is yet editing the line. See the linenoise.h documentation.";
+
+/* input buffer */
+static struct abuf linenoise_buf = {NULL, 0, 0, 0};
+
+/* This function is part of the multiplexed API of linenoise, that is used
+ * in order to implement the blocking variant of the API but can also be
+ * called by the user directly in an event driven program. It will:
  *
- * The resulting string is put into 'buf' when the user type enter, or
- * when ctrl+d is typed.
+ * 1. Initialize the linenoise state passed by the user.
+ * 2. Put the terminal in RAW mode.
+ * 3. Show the prompt.
+ * 4. Return control to the user, that will have to call linenoiseEditFeed()
+ *    each time there is some data arriving in the standard input.
  *
- * The function returns the length of the current buffer. */
-static int linenoiseEdit(int stdin_fd, int stdout_fd, struct abuf *ab, const char *prompt)
-{
-    struct linenoiseState l;
+ * The function returns -1 (errno = ENOTTY) if the terminal is not supported. */
+int linenoiseEditStart(struct linenoiseState *l, int stdin_fd, int stdout_fd, const char *prompt) {
+    if (isUnsupportedTerm() || !isatty(stdin_fd)) {
+        errno = ENOTTY;
+        return -1;
+    }
+    if (enableRawMode(stdin_fd) == -1) return -1;
 
     /* Populate the linenoise state that we pass to functions implementing
      * specific editing functionalities. */
-    l.ifd = stdin_fd;
-    l.ofd = stdout_fd;
-    l.ab = ab;
-    l.prompt = prompt;
-    l.plen = strlen(prompt);
-    l.oldpos = l.pos = 0;
-    l.cols = getColumns(stdin_fd, stdout_fd);
-    l.maxrows = 0;
-    l.history_index = 0;
+    l->in_completion = 0;
+    l->completion_idx = 0;
+    l->ifd = stdin_fd;
+    l->ofd = stdout_fd;
+    l->ab = &linenoise_buf;
+    l->prompt = prompt;
+    l->plen = strlen(prompt);
+    l->oldpos = l->pos = 0;
+    l->cols = getColumns(stdin_fd, stdout_fd);
+    l->maxrows = 0;
+    l->history_index = 0;
 
     /* Buffer starts empty. */
-    abReset(l.ab);
+    abReset(l->ab);
 
     /* The latest history entry is always our current buffer, that
      * initially is just an empty string. */
     linenoiseHistoryAdd("");
 
-    if (write(l.ofd,prompt,l.plen) == -1) return -1;
-    while(1) {
-        char c;
-        int nread;
-        char seq[3];
-        int seqread = 0;
-
-        nread = read(l.ifd,&c,1);
-        if (nread <= 0) return l.ab->len;
-
-        /* Only autocomplete when the callback is set. It returns < 0 when
-         * there was an error reading from fd. Otherwise it will return the
-         * character that should be handled next. */
-        if (c == 9 && completionCallback != NULL) {
-            c = completeLine(&l, &seq[0], &seqread);
-            /* Return on errors */
-            if (c < 0) return l.ab->len;
-            /* Read next character when 0 */
-            if (c == 0) continue;
-        }
+    if (write(l->ofd,prompt,l->plen) == -1) return -1;
+    return 0;
+}
+
+/* This function is part of the multiplexed API of linenoise, see the top
+ * comment on linenoiseEditStart() for more information. Call this function
+ * each time there is some data to read from the standard input file
+ * descriptor. In the case of blocking operations, this function can just be
+ * called in a loop, and block.
+ *
+ * The function returns linenoiseEditMore to signal that line editing is still
+ * in progress, that is, the user didn't yet pressed enter / CTRL-D. Otherwise
+ * the function returns the pointer to the heap-allocated buffer with the
+ * edited line, that the user should free with linenoiseFree().
+ *
+ * On special conditions, NULL is returned and errno is populated:
+ *
+ * EAGAIN if the user pressed Ctrl-C
+ * ENOENT if the user pressed Ctrl-D
+ *
+ * Some other errno: I/O error. */
+char *linenoiseEditFeed(struct linenoiseState *l) {
+    char c;
+    int nread;
+    char seq[3];
+    int seqread = 0;
+
+    nread = read(l->ifd,&c,1);
+    if (nread <= 0) {
+        if (nread == 0) errno = ENOENT;
+        return NULL;
+    }
+
+    /* Only autocomplete when the callback is set. It returns < 0 when
+     * there was an error reading from fd. Otherwise it will return the
+     * character that should be handled next. */
+    if ((l->in_completion || c == 9) && completionCallback != NULL) {
+        int next = completeLine(l, c, &seq[0], &seqread);
+        /* Return on errors */
+        if (next < 0) return NULL;
+        /* Read next character when 0 */
+        if (next == 0) return linenoiseEditMore;
+        c = next;
+    }
 
-        switch(c) {
-        case ENTER:    /* enter */
+    switch(c) {
+    case ENTER:    /* enter */
+        history_len--;
+        lnFree(history[history_len]);
+        if (mlmode) linenoiseEditMoveEnd(l);
+        if (hintsCallback) {
+            /* Force a refresh without hints to leave the previous
+             * line as the user typed it after a newline. */
+            linenoiseHintsCallback *hc = hintsCallback;
+            hintsCallback = NULL;
+            refreshLine(l);
+            hintsCallback = hc;
+        }
+        return lnStrdup(l->ab->b);
+    case CTRL_C:     /* ctrl-c */
+        errno = EAGAIN;
+        return NULL;
+    case BACKSPACE:   /* backspace */
+    case 8:     /* ctrl-h */
+        linenoiseEditBackspace(l);
+        break;
+    case CTRL_D:     /* ctrl-d, remove char at right of cursor, or if the
+                        line is empty, act as end-of-file. */
+        if (l->ab->len > 0) {
+            linenoiseEditDelete(l);
+        } else {
             history_len--;
-            free(history[history_len]);
-            if (mlmode) linenoiseEditMoveEnd(&l);
-            if (hintsCallback) {
-                /* Force a refresh without hints to leave the previous
-                 * line as the user typed it after a newline. */
-                linenoiseHintsCallback *hc = hintsCallback;
-                hintsCallback = NULL;
-                refreshLine(&l);
-                hintsCallback = hc;
-            }
-            return (int)l.ab->len;
-        case CTRL_C:     /* ctrl-c */
-            errno = EAGAIN;
-            return -1;
-        case BACKSPACE:   /* backspace */
-        case 8:     /* ctrl-h */
-            linenoiseEditBackspace(&l);
-            break;
-        case CTRL_D:     /* ctrl-d, remove char at right of cursor, or if the
-                            line is empty, act as end-of-file. */
-            if (l.ab->len > 0) {
-                linenoiseEditDelete(&l);
-            } else {
-                history_len--;
-                free(history[history_len]);
-                return -1;
-            }
-            break;
-        case CTRL_T:    /* ctrl-t, swaps current character with previous. */
-            if (l.pos > 0 && l.pos < l.ab->len) {
-                int aux = ab->b[l.pos-1];
-                ab->b[l.pos-1] = ab->b[l.pos];
-                ab->b[l.pos] = aux;
-                if (l.pos != l.ab->len-1) l.pos++;
-                refreshLine(&l);
-            }
-            break;
-        case CTRL_B:     /* ctrl-b */
-            linenoiseEditMoveLeft(&l);
-            break;
-        case CTRL_F:     /* ctrl-f */
-            linenoiseEditMoveRight(&l);
-            break;
-        case CTRL_P:    /* ctrl-p */
-            linenoiseEditHistoryNext(&l, LINENOISE_HISTORY_PREV);
-            break;
-        case CTRL_N:    /* ctrl-n */
-            linenoiseEditHistoryNext(&l, LINENOISE_HISTORY_NEXT);
-            break;
-        case ESC:    /* escape sequence */
-            /* Read the next two bytes representing the escape sequence.
-             * Use two calls to handle slow terminals returning the two
-             * chars at different times. */
-            if (!seqread) {
-                if (read(l.ifd,seq,1) == -1) break;
-                if (read(l.ifd,seq+1,1) == -1) break;
-            }
+            lnFree(history[history_len]);
+            errno = ENOENT;
+            return NULL;
+        }
+        break;
+    case CTRL_T:    /* ctrl-t, swaps current character with previous. */
+        if (l->pos > 0 && l->pos < l->ab->len) {
+            int aux = l->ab->b[l->pos-1];
+            l->ab->b[l->pos-1] = l->ab->b[l->pos];
+            l->ab->b[l->pos] = aux;
+            if (l->pos != l->ab->len-1) l->pos++;
+            refreshLine(l);
+        }
+        break;
+    case CTRL_B:     /* ctrl-b */
+        linenoiseEditMoveLeft(l);
+        break;
+    case CTRL_F:     /* ctrl-f */
+        linenoiseEditMoveRight(l);
+        break;
+    case CTRL_P:    /* ctrl-p */
+        linenoiseEditHistoryNext(l, LINENOISE_HISTORY_PREV);
+        break;
+    case CTRL_N:    /* ctrl-n */
+        linenoiseEditHistoryNext(l, LINENOISE_HISTORY_NEXT);
+        break;
+    case ESC:    /* escape sequence */
+        /* Read the next two bytes representing the escape sequence.
+         * Use two calls to handle slow terminals returning the two
+         * chars at different times. */
+        if (!seqread) {
+            if (read(l->ifd,seq,1) == -1) break;
+            if (read(l->ifd,seq+1,1) == -1) break;
+        }
 
-            /* ESC [ sequences. */
-            if (seq[0] == '[') {
-                if (seq[1] >= '0' && seq[1] <= '9') {
-                    /* Extended escape, read additional byte. */
-                    if (read(l.ifd,seq+2,1) == -1) break;
-                    if (seq[2] == '~') {
-                        switch(seq[1]) {
-                        case '3': /* Delete key. */
-                            linenoiseEditDelete(&l);
-                            break;
-                        case '1': /* Home */
-                            linenoiseEditMoveHome(&l);
-                            break;
-                        case '4': /* End*/
-                            linenoiseEditMoveEnd(&l);
-                            break;
-                        }
-                    }
-                } else {
+        /* ESC [ sequences. */
+        if (seq[0] == '[') {
+            if (seq[1] >= '0' && seq[1] <= '9') {
+                /* Extended escape, read additional byte. */
+                if (read(l->ifd,seq+2,1) == -1) break;
+                if (seq[2] == '~') {
                     switch(seq[1]) {
-                    case 'A': /* Up */
-                        linenoiseEditHistoryNext(&l, LINENOISE_HISTORY_PREV);
-                        break;
-                    case 'B': /* Down */
-                        linenoiseEditHistoryNext(&l, LINENOISE_HISTORY_NEXT);
+                    case '3': /* Delete key. */
+                        linenoiseEditDelete(l);
                         break;
-                    case 'C': /* Right */
-                        linenoiseEditMoveRight(&l);
+                    case '1': /* Home */
+                        linenoiseEditMoveHome(l);
                         break;
-                    case 'D': /* Left */
-                        linenoiseEditMoveLeft(&l);
-                        break;
-                    case 'H': /* Home */
-                        linenoiseEditMoveHome(&l);
-                        break;
-                    case 'F': /* End*/
-                        linenoiseEditMoveEnd(&l);
+                    case '4': /* End*/
+                        linenoiseEditMoveEnd(l);
                         break;
                     }
                 }
-            }
-
-            /* ESC O sequences. */
-            else if (seq[0] == 'O') {
+            } else {
                 switch(seq[1]) {
+                case 'A': /* Up */
+                    linenoiseEditHistoryNext(l, LINENOISE_HISTORY_PREV);
+                    break;
+                case 'B': /* Down */
+                    linenoiseEditHistoryNext(l, LINENOISE_HISTORY_NEXT);
+                    break;
+                case 'C': /* Right */
+                    linenoiseEditMoveRight(l);
+                    break;
+                case 'D': /* Left */
+                    linenoiseEditMoveLeft(l);
+                    break;
                 case 'H': /* Home */
-                    linenoiseEditMoveHome(&l);
+                    linenoiseEditMoveHome(l);
                     break;
                 case 'F': /* End*/
-                    linenoiseEditMoveEnd(&l);
+                    linenoiseEditMoveEnd(l);
                     break;
                 }
             }
-            break;
-        default:
-            if (linenoiseEditInsert(&l,c)) return -1;
-            break;
-        case CTRL_U: /* Ctrl+u, delete the whole line. */
-            abReset(l.ab);
-            l.pos = l.ab->len = 0;
-            refreshLine(&l);
-            break;
-        case CTRL_K: /* Ctrl+k, delete from current to end of line. */
-            l.ab->b[l.pos] = '\0';
-            l.ab->len = l.pos;
-            refreshLine(&l);
-            break;
-        case CTRL_A: /* Ctrl+a, go to the start of the line */
-            linenoiseEditMoveHome(&l);
-            break;
-        case CTRL_E: /* ctrl+e, go to the end of the line */
-            linenoiseEditMoveEnd(&l);
-            break;
-        case CTRL_L: /* ctrl+l, clear screen */
-            linenoiseClearScreen();
-            refreshLine(&l);
-            break;
-        case CTRL_W: /* ctrl+w, delete previous word */
-            linenoiseEditDeletePrevWord(&l);
-            break;
+        }
+
+        /* ESC O sequences. */
+        else if (seq[0] == 'O') {
+            switch(seq[1]) {
+            case 'H': /* Home */
+                linenoiseEditMoveHome(l);
+                break;
+            case 'F': /* End*/
+                linenoiseEditMoveEnd(l);
+                break;
+            }
+        }
+        break;
+    default:
+        if (linenoiseEditInsert(l,c)) return NULL;
+        break;
+    case CTRL_U: /* Ctrl+u, delete the whole line. */
+        abReset(l->ab);
+        l->pos = l->ab->len = 0;
+        refreshLine(l);
+        break;
+    case CTRL_K: /* Ctrl+k, delete from current to end of line. */
+        l->ab->b[l->pos] = '\0';
+        l->ab->len = l->pos;
+        refreshLine(l);
+        break;
+    case CTRL_A: /* Ctrl+a, go to the start of the line */
+        linenoiseEditMoveHome(l);
+        break;
+    case CTRL_E: /* ctrl+e, go to the end of the line */
+        linenoiseEditMoveEnd(l);
+        break;
+    case CTRL_L: /* ctrl+l, clear screen */
+        linenoiseClearScreen();
+        refreshLine(l);
+        break;
+    case CTRL_W: /* ctrl+w, delete previous word */
+        linenoiseEditDeletePrevWord(l);
+        break;
+    }
+
+    return linenoiseEditMore;
+}
+
+/* This is part of the multiplexed linenoise API. See linenoiseEditStart()
+ * and linenoiseEditFeed() for more information. */
+void linenoiseEditStop(struct linenoiseState *l) {
+    disableRawMode(l->ifd);
+    printf("\n");
+}
+
+/* Hide the current line, when using the multiplexing API: output can be
+ * written afterwards - linenoiseShow() restores the line. */
+void linenoiseHide(struct linenoiseState *l) {
+    char seq[64];
+    struct abuf ab;
+
+    abInit(&ab);
+    if (mlmode) {
+        size_t utf8plen = utf8strlen(l->prompt);
+        int rpos = (utf8plen+utf8strnlen(l->ab->b,l->oldpos)+l->cols)/l->cols; /* cursor relative row. */
+        int j;
+
+        /* go to last row, clear rows up to the first one */
+        if ((int)l->maxrows-rpos > 0) {
+            snprintf(seq,64,"\x1b[%dB", (int)l->maxrows-rpos);
+            abAppend(&ab,seq,strlen(seq));
+        }
+        for (j = 0; j < (int)l->maxrows-1; j++) {
+            snprintf(seq,64,"\r\x1b[0K\x1b[1A");
+            abAppend(&ab,seq,strlen(seq));
         }
     }
-    return l.ab->len;
+    snprintf(seq,64,"\r\x1b[0K");
+    abAppend(&ab,seq,strlen(seq));
+    if (write(l->ofd,ab.b,ab.len) == -1) {} /* Can't recover from write error. */
+    abFree(&ab);
+
+    /* the line is redrawn from scratch */
+    l->maxrows = 0;
+    l->oldpos = 0;
+
+    disableRawMode(l->ifd);
+}
+
+/* Show the current line, when using the multiplexing API. */
+void linenoiseShow(struct linenoiseState *l) {
+    if (enableRawMode(l->ifd) == -1) return;
+    refreshLine(l);
 }
 
 /* This special mode is used by linenoise in order to print scan codes
@@ -1108,16 +1206,21 @@ void linenoisePrintKeyCodes(void) {
     disableRawMode(STDIN_FILENO);
 }
 
-/* This function calls the line editing function linenoiseEdit() using
- * the STDIN file descriptor set in raw mode. */
+/* This function calls the line editing functions using the multiplexed
+ * API in a blocking way.
+ *
+ * The function returns the length of the current buffer or -1. */
 static int linenoiseRaw(struct abuf *ab, const char *prompt) {
-    int count;
+    struct linenoiseState l;
+    char *res;
 
-    if (enableRawMode(STDIN_FILENO) == -1) return -1;
-    count = linenoiseEdit(STDIN_FILENO, STDOUT_FILENO, ab, prompt);
-    disableRawMode(STDIN_FILENO);
-    printf("\n");
-    return count;
+    if (linenoiseEditStart(&l, STDIN_FILENO, STDOUT_FILENO, prompt) == -1) return -1;
+    while ((res = linenoiseEditFeed(&l)) == linenoiseEditMore);
+    linenoiseEditStop(&l);
+
+    if (res == NULL) return -1;
+    lnFree(res);
+    return ab->len;
 }
 
 /* This function is called when linenoise() is called with the standard
@@ -1134,16 +1237,16 @@ static char *linenoiseNoTTY(void) {
             if (maxlen == 0) maxlen = 16;
             maxlen *= 2;
             char *oldval = line;
-            line = realloc(line,maxlen);
+            line = lnRealloc(line,maxlen);
             if (line == NULL) {
-                if (oldval) free(oldval);
+                if (oldval) lnFree(oldval);
                 return NULL;
             }
         }
         int c = fgetc(stdin);
         if (c == EOF || c == '\n') {
             if (c == EOF && len == 0) {
-                free(line);
+                lnFree(line);
                 return NULL;
             } else {
                 line[len] = '\0';
@@ -1156,9 +1259,6 @@ static char *linenoiseNoTTY(void) {
     }
 }
 
-/* input buffer */
-static struct abuf linenoise_buf = {NULL, 0, 0, 0};
-
 /* The high level function that is the main API of the linenoise library.
  * This function checks if the terminal has basic capabilities, just checking
  * for a blacklist of stupid terminals, and later either calls the line
@@ -1187,11 +1287,11 @@ char *linenoise(const char *prompt) {
             abAppend(ab, buf, len);
         }
         abChomp(ab);
-        return strdup(ab->b);
+        return lnStrdup(ab->b);
     } else {
         count = linenoiseRaw(ab,prompt);
         if (count == -1) return NULL;
-        return strdup(ab->b);
+        return lnStrdup(ab->b);
     }
 }
 
@@ -1200,7 +1300,7 @@ char *linenoise(const char *prompt) {
  * created with. Useful when the main program is using an alternative
  * allocator. */
 void linenoiseFree(void *ptr) {
-    free(ptr);
+    lnFree(ptr);
 }
 
 /* ================================ History ================================= */
@@ -1212,8 +1312,8 @@ static void freeHistory(void) {
         int j;
 
         for (j = 0; j < history_len; j++)
-            free(history[j]);
-        free(history);
+            lnFree(history[j]);
+        lnFree(history);
     }
 }
 
@@ -1238,7 +1338,7 @@ int linenoiseHistoryAdd(const char *line) {
 
     /* Initialization on first call. */
     if (history == NULL) {
-        history = malloc(sizeof(char*)*history_max_len);
+        history = lnMalloc(sizeof(char*)*history_max_len);
         if (history == NULL) return 0;
         memset(history,0,(sizeof(char*)*history_max_len));
     }
@@ -1248,10 +1348,10 @@ int linenoiseHistoryAdd(const char *line) {
 
     /* Add an heap allocated copy of the line in the history.
      * If we reached the max length, remove the older line. */
-    linecopy = strdup(line);
+    linecopy = lnStrdup(line);
     if (!linecopy) return 0;
     if (history_len == history_max_len) {
-        free(history[0]);
+        lnFree(history[0]);
         memmove(history,history+1,sizeof(char*)*(history_max_len-1));
         history_len--;
     }
@@ -1271,19 +1371,19 @@ int linenoiseHistorySetMaxLen(int len) {
     if (history) {
         int tocopy = history_len;
 
-        new = malloc(sizeof(char*)*len);
+        new = lnMalloc(sizeof(char*)*len);
         if (new == NULL) return 0;
 
         /* If we can't copy everything, free the elements we'll not use. */
         if (len < tocopy) {
             int j;
 
-            for (j = 0; j < tocopy-len; j++) free(history[j]);
+            for (j = 0; j < tocopy-len; j++) lnFree(history[j]);
             tocopy = len;
         }
         memset(new,0,sizeof(char*)*len);
         memcpy(new,history+(history_len-tocopy), sizeof(char*)*tocopy);
-        free(history);
+        lnFree(history);
         history = new;
     }
     history_max_len = len;
@@ -1331,3 +1431,30 @@ int linenoiseHistoryLoad(const char *filename) {
     fclose(fp);
     return 0;
 }
+
+/* ================================ Memory ================================== */
+
+/* Report the memory held by linenoise: the history lines together with the
+ * array of pointers to them, and the buffer of the edited line. Any of the
+ * pointers may be NULL. */
+void linenoiseMemoryUsage(size_t *history_bytes, size_t *history_entries, size_t *buffer_bytes) {
+    if (history_bytes) {
+        size_t bytes = 0;
+        int j;
+
+        if (history) {
+            bytes = sizeof(char*)*history_max_len;
+            for (j = 0; j < history_len; j++)
+                bytes += strlen(history[j])+1;
+        }
+        *history_bytes = bytes;
+    }
+    if (history_entries) *history_entries = history_len;
+    if (buffer_bytes) *buffer_bytes = linenoise_buf.blen;
+}
+
+/* Release the buffer of the edited line: it keeps the size of the longest
+ * line edited so far. Must not be called while a line is edited. */
+void linenoiseReleaseBuffer(void) {
+    abFree(&linenoise_buf);
+}
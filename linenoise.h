@@ -43,6 +43,24 @@
 extern "C" {
 #endif
 
+/* The linenoiseState structure represents the state during line editing.
+ * We pass this state to functions implementing specific editing
+ * functionalities. */
+struct linenoiseState {
+    int in_completion;  /* TAB was pressed: input is handled by completeLine(). */
+    size_t completion_idx; /* Index of completion currently shown. */
+    int ifd;            /* Terminal stdin file descriptor. */
+    int ofd;            /* Terminal stdout file descriptor. */
+    struct abuf *ab;    /* Edited line buffer. */
+    const char *prompt; /* Prompt to display. */
+    size_t plen;        /* Prompt length. */
+    size_t pos;         /* Current cursor position. */
+    size_t oldpos;      /* Previous refresh cursor position. */
+    size_t cols;        /* Number of columns in terminal. */
+    size_t maxrows;     /* Maximum num of rows used so far (multiline mode) */
+    int history_index;  /* The history index we are currently editing. */
+};
+
 typedef struct linenoiseCompletions {
   size_t len;
   char **cvec;
@@ -56,6 +74,16 @@ void linenoiseSetHintsCallback(linenoiseHintsCallback *);
 void linenoiseSetFreeHintsCallback(linenoiseFreeHintsCallback *);
 void linenoiseAddCompletion(linenoiseCompletions *, const char *);
 
+/* Non blocking API: start editing, feed it whenever input is readable,
+ * stop it when a line was returned. linenoiseEditFeed() returns
+ * linenoiseEditMore while the line is still edited. */
+extern char *linenoiseEditMore;
+int linenoiseEditStart(struct linenoiseState *l, int stdin_fd, int stdout_fd, const char *prompt);
+char *linenoiseEditFeed(struct linenoiseState *l);
+void linenoiseEditStop(struct linenoiseState *l);
+void linenoiseHide(struct linenoiseState *l);
+void linenoiseShow(struct linenoiseState *l);
+
 char *linenoise(const char *prompt);
 void linenoiseFree(void *ptr);
 int linenoiseHistoryAdd(const char *line);
@@ -65,6 +93,9 @@ int linenoiseHistoryLoad(const char *filename);
 void linenoiseClearScreen(void);
 void linenoiseSetMultiLine(int ml);
 void linenoisePrintKeyCodes(void);
+void linenoiseSetAllocator(void *(*malloc_fn)(size_t), void *(*realloc_fn)(void *, size_t), void (*free_fn)(void *));
+void linenoiseMemoryUsage(size_t *history_bytes, size_t *history_entries, size_t *buffer_bytes);
+void linenoiseReleaseBuffer(void);
 
 #ifdef __cplusplus
 }
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "tclln.h"
 
@@ -39,13 +41,51 @@ int main (int argc, const char *argv[])
 {
     TclLN tclln;
 
-    tclln = tclln_new (argv[0]);
+    tclln = tclln_new_with_options (argv[0], TCLLN_LAZY_INIT);
 
     tclln_provide_completion_command (tclln, NULL);
+    tclln_provide_cached_source (tclln);
     tclln_add_command (tclln, "mycommand", (const char * const []) {"-activate", "-deactivate", "-value", "-name", "-help", NULL}, custom_command, NULL, NULL);
     tclln_set_prompt  (tclln, "tcllnsh> ",
                                "       : ");
 
+    /* Ctrl-C interrupts the script given as argument too */
+    tclln_set_interrupt_handler (tclln, true);
+
+    /* -p FILE: profile, write folded stacks to FILE at the end */
+    const char *profile_file = NULL;
+
+    if ((argc > 2) && (strcmp (argv[1], "-p") == 0)) {
+        profile_file = argv[2];
+
+        argv += 2;
+        argc -= 2;
+
+        tclln_profile_start (tclln, 0);
+    }
+
+    /* -j N: run scripts in parallel with N threads */
+    if ((argc > 1) && (strcmp (argv[1], "-j") == 0)) {
+        /* the profiler samples only the interpreter of this thread, not those of the workers */
+        if (profile_file != NULL) {
+            printf ("-p cannot be combined with -j\n");
+            tclln_profile_stop (tclln);
+            tclln_free (tclln);
+            return 1;
+        }
+
+        if (argc < 4) {
+            printf ("Expected number of threads and at least 1 script after -j\n");
+            return 1;
+        }
+
+        bool result = tclln_run_files_parallel (tclln, &argv[3], argc - 3, atoi (argv[2]), NULL);
+
+        tclln_free (tclln);
+
+        return (result ? 0 : 1);
+    }
+
     if (argc > 1) {
         if (argc > 2) {
             printf ("Too many arguments - expected 0 or 1\n");
@@ -57,6 +97,11 @@ int main (int argc, const char *argv[])
 
     tclln_run (tclln);
 
+    if (profile_file != NULL) {
+        tclln_profile_stop (tclln);
+        tclln_profile_write (tclln, profile_file);
+    }
+
     tclln_free (tclln);
 
     return 0;
@@ -24,38 +24,353 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <errno.h>
+#include <signal.h>
+#include <time.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <glib.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 #include "linenoise.h"
+#include "completion_hash.h"
 
 
 /*************************************************
  * data struct
  *************************************************/
 
+/* incremental check for complete tcl commands (see Tcl_CommandComplete) */
+struct command_scanner {
+    GByteArray *contexts;       /* stack of command substitutions, quoted words and array indices */
+    int        brace_depth;     /* > 0: inside braced word */
+    int        var_state;       /* position in variable name after '$' */
+    int        expand_state;    /* detection of {*} */
+    int        close_state;     /* after closing brace/quote of a word */
+    bool       backslash;       /* previous character was a backslash */
+    bool       continuation;    /* input ends with backslash-newline between words */
+    bool       comment;
+    bool       command_start;
+    bool       word_start;
+    bool       error;           /* syntax error: command is evaluated (and fails) as it is */
+};
+
+/* arguments of a tcl command - defaults from completion_defaults.txt, or added at runtime
+ * (then kept in completion_arg_table, strings in completion_arg_strings) */
+struct default_completion {
+    const char         *command;
+    const char * const *args;       /* sorted */
+    int                n_args;
+};
+
+/* custom command - kept for creating further interpreters */
+struct command_registration {
+    char           *name;
+    char           **arg_complete_list;
+    Tcl_ObjCmdProc *proc;
+    ClientData     client_data;
+
+    /* TCLLN_PROFILE_COMMANDS: command calls profile_command_proc */
+    Tcl_CmdDeleteProc *delete_proc;
+    unsigned long     calls;
+    unsigned long     time_total;   /* ns */
+    unsigned long     time_min;     /* ns */
+    unsigned long     time_max;     /* ns */
+    unsigned long     histogram [TCLLN_COMMAND_HISTOGRAM_SIZE];
+};
+
+/* result of a script run by tclln_run_files_parallel */
+struct parallel_result {
+    bool  done;
+    int   status;
+    char  *output;
+    gsize output_len;
+};
+
+/* scripts run by tclln_run_files_parallel */
+struct parallel_batch {
+    struct tclln_data      *tclln;
+    const char * const     *script_names;
+    int                    n_scripts;
+    volatile gint          next_script;     /* work queue: index of next script to run */
+    struct parallel_result *results;
+
+    GMutex                 mutex;           /* protects results */
+    GCond                  cond;            /* signalled when a script is done */
+};
+
+/* initialized instances ready for use */
+struct tclln_pool {
+    struct tclln_data *tclln;               /* template: custom commands of new instances */
+    GPtrArray         *instances;
+    int               size;
+    bool              refill_scheduled;     /* idle handler pending */
+
+    /* statistics */
+    unsigned long     acquires;
+    unsigned long     misses;               /* pool was empty on acquire */
+    unsigned long     latency_sum;          /* ns */
+    unsigned long     latency_max;          /* ns */
+};
+
+/* script cached by tclln_run_file and source */
+struct script_cache_entry {
+    char            *path;      /* normalized */
+    dev_t           device;
+    ino_t           inode;
+    off_t           size;
+    struct timespec mtime;
+
+    Tcl_Obj         *script;    /* whole script for source - NULL if only run once by tclln_run_file */
+    GPtrArray       *commands;  /* top-level commands for tclln_run_file - NULL until needed */
+    size_t          bytes;
+    GList           *lru_link;  /* in script_lru of tclln */
+};
+
+/* sorted entries of a directory for file completion - see directory_cache_lookup */
+struct directory_listing {
+    char            *path;          /* as given to opendir */
+    dev_t           device;
+    ino_t           inode;
+    struct timespec mtime;          /* of the directory before it was read */
+    struct timespec listed;
+
+    GPtrArray       *names;         /* sorted - strings of strings */
+    GStringChunk    *strings;
+    size_t          bytes;
+    GList           *lru_link;      /* in directory_lru of tclln */
+};
+
+/* directory read by a thread for file completion - see directory_scan_start */
+struct directory_scan {
+    char                     *path;
+    struct directory_listing *listing;      /* NULL if the directory can't be read */
+    bool                     done;          /* guarded by directory_scan_mutex of tclln */
+    GThread                  *thread;       /* NULL if read without thread */
+    struct tclln_data        *tclln;
+};
+
+/* candidate of fuzzy completion */
+struct fuzzy_match {
+    const char *name;
+    int        score;
+    int        length;
+};
+
+/* stdout / stderr of the interactive shell: hides the prompt while tcl writes output */
+struct shell_output {
+    struct tclln_data *tclln;
+    Tcl_Channel       channel;      /* stacked on the std channel - NULL if not available */
+};
+
+/* top-level command of a file run by tclln_run_file - see tclln_set_hotspot_report */
+struct hotspot {
+    int           first_line;
+    int           last_line;
+    unsigned long time;         /* ns */
+    long          memory;       /* growth of heap in use in bytes - 0 if not recorded */
+};
+
+/* block of an arena - see arena_alloc */
+struct arena_block {
+    struct arena_block *next;
+    size_t             size;        /* bytes of data */
+    size_t             used;
+    char               data [];
+};
+
+/* bump allocator for temporary data of a request - released in bulk by arena_reset */
+struct arena {
+    struct arena_block *blocks;     /* block allocated from first */
+    size_t             block_size;  /* size of regular blocks */
+};
+
+/* unique strings of the argument table - see tclln_memory_stats */
+struct memory_strings {
+    GHashTable *seen;
+    size_t     bytes;
+};
+
+/* compacted argument table - see tclln_memory_trim */
+struct memory_compaction {
+    GStringChunk *strings;
+    GHashTable   *table;
+};
+
+/* names of a namespace in a completion index - see index_select_namespace */
+struct index_namespace {
+    char      *name;            /* fully qualified - "::" for the global namespace */
+    GPtrArray *names;           /* simple names, sorted - strings of the index */
+    unsigned  generation;       /* variable index: index_generation when listed */
+    bool      stale;            /* variable index: a variable was unset - list again */
+};
+
+/* sorted command names for completion - rename/delete traces of the commands keep it current,
+ * new commands are found by comparing counts once the generation changed */
+struct command_index {
+    GHashTable   *namespaces;   /* name -> struct index_namespace - NULL until first completion */
+    GStringChunk *strings;
+    unsigned     generation;    /* index_generation of last validation */
+    GPtrArray    *qualified;    /* fully qualified names of all namespaces for fuzzy completion - NULL until
+                                 * used and after a change */
+    GStringChunk *qualified_strings;
+};
+
+/* keys of an array variable - kept until a write/unset trace of the array marks them stale */
+struct variable_array {
+    char              *name;        /* fully qualified */
+    GPtrArray         *keys;        /* sorted - strings of key_strings */
+    GStringChunk      *key_strings;
+    bool              stale;
+    struct tclln_data *tclln;
+};
+
+/* sorted variable names for completion - namespaces and arrays are indexed when first completed,
+ * namespaces are listed again once the generation changed and their count differs or a variable
+ * was unset */
+struct variable_index {
+    GHashTable   *namespaces;   /* name -> struct index_namespace - NULL until first completion */
+    GHashTable   *arrays;       /* name -> struct variable_array */
+    GStringChunk *strings;
+};
+
+/* output of a command result - see result_print */
+struct result_writer {
+    FILE   *out;
+    char   *buf;            /* output buffer of tclln */
+    size_t len;             /* bytes in buffer */
+    struct arena *arena;    /* elements too large for the buffer are quoted here */
+    size_t bytes;           /* bytes of result written */
+    size_t max_bytes;       /* 0: no limit */
+    bool   truncated;
+};
+
+/* interactive shell driven by the tcl event loop */
+struct shell_state {
+    struct linenoiseState  edit;
+    bool                   editing;     /* linenoise edit started - prompt shown */
+    bool                   hidden;      /* prompt hidden by output, shown again when idle */
+    bool                   done;        /* end of input */
+
+    Tcl_Channel            input;       /* stdin */
+    struct shell_output    outputs[2];  /* stdout, stderr */
+
+    GString                *lines;      /* multi-line input */
+    struct command_scanner scanner;
+};
+
 struct tclln_data {
     /* tcl */
     Tcl_Interp *tcl_interp;
+    int        options;
+    bool       init_pending;    /* lazy init: init library not yet sourced */
+
+    /* startup phases in ns */
+    unsigned long time_create_interp;
+    unsigned long time_encoding;
+    unsigned long time_init;
+    unsigned long time_completion;
+
+    /* custom commands */
+    GPtrArray  *commands;
+    char       *completion_command_name;
 
     /* prompt */
     const char *prompt_string_main;
     const char *prompt_string_multiline;
     bool       multiline;
+    bool       single_row;          /* edit long lines in one scrolled row */
+
+    /* interactive shell - NULL if not running */
+    struct shell_state *shell;
 
     /* completion */
     GString      *completion_begin;
 
-    GList        *completion_list;
-    GStringChunk *completion_strings;
+    GPtrArray    *completion_candidates;    /* strings of completion_arena */
+    struct arena completion_arena;          /* reset on each completion */
 
-    GTree        *completion_arg_table;
+    GHashTable   *completion_arg_table;     /* command -> struct default_completion */
     GStringChunk *completion_arg_strings;
 
+    struct command_index  command_index;
+    struct variable_index variable_index;
+    int                   index_epoch;          /* info cmdcount after last read of an index */
+    int                   index_epoch_step;     /* commands counted by reading the epoch - 0: unknown */
+    unsigned              index_generation;     /* advances when other commands ran */
+
+    GHashTable            *directory_cache;     /* path -> struct directory_listing - NULL until first use */
+    GQueue                directory_lru;        /* listings, most recently used first */
+    size_t                directory_cache_bytes;
+    GPtrArray             *directory_scans;     /* struct directory_scan - running or not yet collected */
+    GMutex                directory_scan_mutex;
+    GCond                 directory_scan_cond;
+    unsigned long         completion_budget_ms; /* 0: wait until directories are read */
+    bool                  fuzzy_completion;     /* match by subsequence and rank */
+
+    /* script cache */
+    GHashTable     *script_cache;           /* normalized path -> struct script_cache_entry */
+    GQueue         script_lru;              /* entries, most recently used first */
+    size_t         script_cache_bytes;
+    unsigned long  script_cache_hits;
+    unsigned long  script_cache_misses;
+    Tcl_ObjCmdProc *source_proc;
+    ClientData     source_client_data;
+
+    /* output of results */
+    char   *result_buffer;          /* NULL until first result is printed */
+    struct arena eval_arena;        /* reset after each printed result */
+    size_t result_max_bytes;        /* 0: no limit */
+    size_t result_max_elements;     /* 0: no limit */
+
+    /* hotspot report of tclln_run_file */
+    int        hotspot_top_n;           /* 0: disabled */
+    bool       hotspot_memory;          /* record growth of memory too */
+    GArray     *hotspots;               /* struct hotspot - NULL if no file is recorded */
+    int        hotspot_depth;           /* evaluating while top-level commands of the file run */
+    int        hotspot_line;            /* line of next command */
+
+    /* interrupt of interactive commands */
+    Tcl_AsyncHandler interrupt_async;       /* SIGINT: cancels the running command */
+    int              evaluating;            /* nesting depth of running commands that can be interrupted */
+    bool             interrupt_sigint;      /* install SIGINT handler while evaluating - shell or tclln_set_interrupt_handler */
+    bool             interrupt_installed;   /* this instance owns the SIGINT handler now */
+    struct sigaction interrupt_saved_action;
+
+    /* watchdog: time limit of interactive commands */
+    unsigned long command_timeout_ms;       /* 0: no limit */
+    GThread       *watchdog;
+    GMutex        watchdog_mutex;
+    GCond         watchdog_cond;
+    gint64        watchdog_deadline;        /* monotonic time in us - 0 if no command is running */
+    bool          watchdog_quit;
+
+    /* sampling profiler */
+    GThread          *profile_thread;       /* NULL if not running */
+    Tcl_AsyncHandler profile_async;
+    GHashTable       *profile_stacks;       /* folded stack -> number of samples (guint64 *) */
+    GString          *profile_stack;
+    unsigned long    profile_interval_us;
+    volatile gint    profile_ticks;         /* samples requested by the thread, not yet taken */
+    volatile gint    profile_cost_us;       /* time of last sample */
+    GMutex           profile_mutex;
+    GCond            profile_cond;
+    bool             profile_quit;
+
     /* exit */
     int          return_code;
     bool         exit_tcl;
+    bool         exit_unwind;   /* exit cancels the running evaluation */
+
+    bool         parallel_isolated;     /* tclln_run_files_parallel: fresh instance per script */
 };
 
 
@@ -63,21 +378,196 @@ struct tclln_data {
  * non-header header
  *************************************************/
 
-static gboolean free_glist_value_in_tree (gpointer key, gpointer value, gpointer data);
+static struct tclln_data *tclln_new_like (struct tclln_data *tclln, int options);
+
+static int init_library (struct tclln_data *tclln);
+static int lazy_init (struct tclln_data *tclln);
+static int lazy_init_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+static char *lazy_auto_path_trace (ClientData client_data, Tcl_Interp *interp, const char *name1, const char *name2, int flags);
+static int lazy_clock_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+static void lazy_clock_restore (struct tclln_data *tclln);
+static int lazy_unknown_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+static int lazy_package_unknown_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+
+static struct timespec time_now (void);
+static unsigned long time_elapsed_ns (struct timespec t_start);
+
+static void pool_refill_idle (ClientData client_data);
+static void pool_schedule_refill (struct tclln_pool *pool);
 
 static const char *prompt (struct tclln_data *tclln);
 
+static bool shell_edit_start (struct tclln_data *tclln);
+static void shell_input_handler (ClientData client_data, int mask);
+static void shell_line (struct tclln_data *tclln, char *line);
+static void shell_show_idle (ClientData client_data);
+static void shell_output_stack (struct tclln_data *tclln);
+static void shell_output_unstack (struct tclln_data *tclln);
+static int shell_output_close (ClientData instance_data, Tcl_Interp *interp);
+static int shell_output_input (ClientData instance_data, char *buf, int to_read, int *error_code);
+static int shell_output_output (ClientData instance_data, const char *buf, int to_write, int *error_code);
+static void shell_output_watch (ClientData instance_data, int mask);
+static int shell_output_get_handle (ClientData instance_data, int direction, ClientData *handle);
+
+static void result_print (struct tclln_data *tclln, FILE *out);
+static bool result_write_element (struct result_writer *writer, Tcl_Obj *element, bool first);
+static bool result_write (struct result_writer *writer, const char *data, size_t length);
+static void result_flush (struct result_writer *writer);
+
+static bool hotspot_begin (struct tclln_data *tclln);
+static bool hotspot_recording (struct tclln_data *tclln);
+static void hotspot_end (struct tclln_data *tclln, const char *script_name);
+static void hotspot_record (struct tclln_data *tclln, const char *command, size_t length,
+                struct timespec t_start, long memory_start);
+static gint hotspot_compare (gconstpointer a, gconstpointer b);
+static long memory_in_use (void);
+
+static void arena_init (struct arena *arena, size_t block_size);
+static void *arena_alloc (struct arena *arena, size_t size);
+static char *arena_strdup (struct arena *arena, const char *string, gssize length);
+static char *arena_concat (struct arena *arena, const char *first, const char *second);
+static void arena_reset (struct arena *arena);
+static void arena_free (struct arena *arena);
+static size_t arena_size (const struct arena *arena);
+
+static void memory_count_arg_strings (gpointer key, gpointer value, gpointer data);
+static void memory_count_arg_lists (gpointer key, gpointer value, gpointer data);
+static void memory_compact_arg_strings (gpointer key, gpointer value, gpointer data);
+static int memory_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+
+static void interrupt_begin (struct tclln_data *tclln);
+static void interrupt_next (struct tclln_data *tclln);
+static void interrupt_end (struct tclln_data *tclln);
+static void interrupt_reset (struct tclln_data *tclln);
+static void interrupt_signal (int signal_number);
+static int interrupt_async_proc (ClientData client_data, Tcl_Interp *interp, int code);
+static gpointer watchdog_thread (gpointer data);
+
+static bool run_file (struct tclln_data *tclln, const char *script_name, bool verbose);
+static bool run_script (struct tclln_data *tclln, const char *script, size_t length, bool verbose);
+static bool run_stream (struct tclln_data *tclln, int fd, bool verbose);
+static bool run_pipe (struct tclln_data *tclln, int fd);
+static bool run_pipe_eval (struct tclln_data *tclln, const char *command, size_t length);
+static bool run_cached_script (struct tclln_data *tclln, struct script_cache_entry *entry, bool verbose);
+static bool run_print_result (struct tclln_data *tclln, int tcl_res, bool verbose);
+static const char *script_next_command (struct command_scanner *scanner, const char *cmd_start, const char *script_end);
+
+static gpointer parallel_worker (gpointer data);
+static int parallel_worker_run (struct tclln_data *worker, const char *script_name);
+static int parallel_worker_eval (struct tclln_data *worker, Tcl_Obj *path);
+static int output_channel_close (ClientData instance_data, Tcl_Interp *interp);
+static int output_channel_input (ClientData instance_data, char *buf, int to_read, int *error_code);
+static int output_channel_output (ClientData instance_data, const char *buf, int to_write, int *error_code);
+static void output_channel_watch (ClientData instance_data, int mask);
+static int output_channel_get_handle (ClientData instance_data, int direction, ClientData *handle);
+
+static void command_registration_free (gpointer data);
+static struct command_registration *command_registration_find (struct tclln_data *tclln, const char *command_name);
+
+static void profile_clock_init (void);
+static inline guint64 profile_clock (void);
+static int profile_command_proc (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+static void profile_command_delete (ClientData client_data);
+static gpointer profile_sample_thread (gpointer data);
+static int profile_sample_async_proc (ClientData client_data, Tcl_Interp *interp, int code);
+static void profile_sample (struct tclln_data *tclln, int weight);
+static int profile_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+static Tcl_Obj *profile_command_stats_obj (const struct command_registration *command);
+static int profile_command_stats_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+
+static struct script_cache_entry *script_cache_lookup (struct tclln_data *tclln, Tcl_Obj *path, bool load);
+static void script_cache_insert (struct tclln_data *tclln, struct script_cache_entry *entry);
+static void script_cache_limit (struct tclln_data *tclln, struct script_cache_entry *keep);
+static void script_cache_remove (struct tclln_data *tclln, struct script_cache_entry *entry);
+static void script_cache_free (struct tclln_data *tclln);
+static bool script_cache_entry_valid (const struct script_cache_entry *entry, const struct stat *file_stat);
+static void script_cache_entry_free (gpointer data);
+static void script_cache_obj_free (gpointer data);
+static GPtrArray *script_cache_commands (struct tclln_data *tclln, struct script_cache_entry *entry);
+static Tcl_Obj *script_cache_set_info_script (Tcl_Interp *interp, Tcl_Obj *script_name);
+static Tcl_Obj *script_load (const char *file_name, struct stat *file_stat);
+static int script_cache_source (struct tclln_data *tclln, Tcl_Obj *script, Tcl_Obj *path);
+static int source_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+static int script_cache_stats_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
+
+static void command_scanner_init     (struct command_scanner *scanner);
+static void command_scanner_free     (struct command_scanner *scanner);
+static void command_scanner_reset    (struct command_scanner *scanner);
+static void command_scanner_feed     (struct command_scanner *scanner, const char *input, size_t length);
+static bool command_scanner_complete (const struct command_scanner *scanner);
+
 static void completion (const char *input_buffer, linenoiseCompletions *linenoise_completion);
 static void completion_table_add_command (struct tclln_data *tclln, const char *command, const char *const arg_complete_list[]);
-static void completion_table_add_defaults (struct tclln_data *tclln);
+static void completion_table_free_args (gpointer data);
+static const struct default_completion *completion_table_lookup_default (const char *command);
 static void completion_generate (struct tclln_data *tclln);
-static void completion_add_tcl_result (Tcl_Interp *interp, GStringChunk *gs_chunk, GList **res_list);
-static void completion_generate_tcl_procs (Tcl_Interp *interp, GStringChunk *gs_chunk, GList **res_list, const char *base);
-static void completion_generate_tcl_vars  (Tcl_Interp *interp, GStringChunk *gs_chunk, GList **res_list, const char *base);
-static void completion_generate_args (GTree *arg_table, GStringChunk *gs_chunk, GList **res_list, const char *command, const char *base);
-static void completion_generate_files (GStringChunk *gs_chunk, GList **res_list, const char *base);
+static void completion_lines (struct tclln_data *tclln, const char *input);
+static gint completion_compare (gconstpointer a, gconstpointer b);
+static void completion_remove_failed (GPtrArray *candidates);
+static void completion_generate_tcl_procs (struct tclln_data *tclln, const char *base);
+static void completion_generate_tcl_vars  (struct tclln_data *tclln, const char *base);
+static void completion_generate_args (GHashTable *arg_table, GPtrArray *candidates, const char *command, const char *base);
+static const char *completion_files_dir (struct arena *arena, const char *base, const char **file);
+static void completion_generate_files_start (struct tclln_data *tclln, const char *base);
+static void completion_generate_files (struct tclln_data *tclln, const char *base, gint64 deadline);
+static void completion_rank (GPtrArray *candidates, const char *pattern, struct arena *arena);
+static gint completion_rank_compare (gconstpointer a, gconstpointer b);
+static void fuzzy_heap_up (struct fuzzy_match *heap, guint pos);
+static void fuzzy_heap_down (struct fuzzy_match *heap, guint n_heap, guint pos);
+static void fuzzy_score (const char *const *names, guint n_names, int skip, const char *pattern, gint16 *scores,
+                         struct arena *arena);
+static void fuzzy_score_batch (const guint8 *chars, int length, const char *pattern, bool fold, gint16 *scores);
 static int tcl_completion_add_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
 
+static struct index_namespace *index_namespace_new (GHashTable *namespaces, GStringChunk *strings, const char *ns_name);
+static void index_namespace_free (gpointer data);
+static gboolean index_namespace_unseen (gpointer key, gpointer value, gpointer data);
+static void index_namespace_mark_stale (gpointer key, gpointer value, gpointer data);
+static Tcl_Obj *index_eval (Tcl_Interp *interp, int objc, const char *const words[]);
+static int index_epoch (Tcl_Interp *interp);
+static unsigned index_generation (struct tclln_data *tclln);
+static void index_sync (struct tclln_data *tclln);
+static const char *qualified_name_tail (const char *name);
+static const char *index_select_namespace (struct arena *arena, const char *base, const char **qualifier, const char **tail);
+static int index_find (GPtrArray *names, const char *prefix);
+static int index_add_matches (GPtrArray *names, const char *prefix, const char *qualifier, struct arena *arena, GPtrArray *candidates, int limit);
+static void index_usage (GHashTable *namespaces, size_t *bytes, size_t *entries);
+
+static void command_index_free (struct command_index *index);
+static void command_index_changed (struct command_index *index);
+static bool command_index_validate (struct tclln_data *tclln);
+static void command_index_scan (struct tclln_data *tclln, const char *ns_name, GHashTable *seen);
+static void command_index_fill (struct tclln_data *tclln, struct index_namespace *ns, Tcl_Obj *list);
+static void command_index_trace (ClientData client_data, Tcl_Interp *interp, const char *old_name, const char *new_name, int flags);
+static void command_index_lookup (struct command_index *index, struct arena *arena, GPtrArray *candidates, const char *base);
+static void command_index_all (struct command_index *index, GPtrArray *candidates, const char *base);
+
+static void variable_index_free (struct tclln_data *tclln);
+static bool variable_index_create (struct tclln_data *tclln);
+static struct index_namespace *variable_index_namespace (struct tclln_data *tclln, const char *ns_name);
+static void variable_index_fill (struct tclln_data *tclln, struct index_namespace *ns, Tcl_Obj *list);
+static char *variable_index_unset_trace (ClientData client_data, Tcl_Interp *interp, const char *name1, const char *name2, int flags);
+static struct variable_array *variable_index_array (struct tclln_data *tclln, const char *array_name);
+static void variable_array_drop (struct tclln_data *tclln, struct variable_array *array);
+static void variable_array_free (gpointer data);
+static char *variable_array_trace (ClientData client_data, Tcl_Interp *interp, const char *name1, const char *name2, int flags);
+static void variable_index_usage (struct variable_index *index, size_t *bytes, size_t *entries);
+
+static bool directory_cache_lookup (struct tclln_data *tclln, const char *path, struct directory_listing **listing);
+static void directory_cache_insert (struct tclln_data *tclln, struct directory_listing *listing);
+static void directory_scan_start (struct tclln_data *tclln, const char *path);
+static struct directory_scan *directory_scan_find (struct tclln_data *tclln, const char *path);
+static gpointer directory_scan_thread (gpointer data);
+static struct directory_listing *directory_scan_wait (struct tclln_data *tclln, const char *path, gint64 deadline);
+static struct directory_listing *directory_scan_collect (struct tclln_data *tclln, struct directory_scan *scan);
+static void directory_scans_collect (struct tclln_data *tclln);
+static void directory_scans_free (struct tclln_data *tclln);
+static struct directory_listing *directory_list (const char *path);
+static bool directory_listing_valid (const struct directory_listing *listing, const struct stat *dir_stat);
+static void directory_cache_remove (struct tclln_data *tclln, struct directory_listing *listing);
+static void directory_listing_free (gpointer data);
+static void directory_cache_free (struct tclln_data *tclln);
+
 static int exit_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]);
 
 /*************************************************
@@ -89,68 +579,300 @@ static const int default_history_size       = 100;
 static const char *default_prompt_main      = "> ";
 static const char *default_prompt_multiline = ": ";
 
+static const size_t script_cache_max_size      = 64 * 1024 * 1024;   /* bytes of cached scripts */
+static const off_t  script_cache_max_file_size = 16 * 1024 * 1024;   /* larger files are not cached */
+
+static const size_t result_buffer_size      = 256 * 1024;
+
+static const int completion_max_variables  = 1000;     /* variables and array keys offered by one completion */
+static const unsigned long default_completion_budget_ms = 50;
+
+static const int completion_max_fuzzy    = 1000;     /* best matches offered by fuzzy completion */
+static const int fuzzy_max_pattern       = 64;       /* longer words are completed by prefix */
+static const int fuzzy_max_length        = 4096;     /* characters of a name that are matched */
+static const int fuzzy_no_match          = -16384;   /* scores up to it: pattern not found */
+static const int fuzzy_score_match       = 16;
+static const int fuzzy_score_gap         = 1;        /* per character between matches */
+static const int fuzzy_bonus_boundary    = 8;        /* match at start or after a separator */
+static const int fuzzy_bonus_camel       = 7;        /* uppercase match after lowercase */
+static const int fuzzy_bonus_consecutive = 8;        /* like a boundary: exact words rank first */
+static const char *fuzzy_separators      = ":_-/. (";  /* a match after them starts a word */
+static const int fuzzy_lanes             = 8;        /* names scored at once - 16 bit scores of a 128 bit vector */
+
+static const size_t directory_cache_max_size = 16 * 1024 * 1024;   /* bytes of cached directory listings */
+static const gint64 directory_mtime_margin_ns        = 20 * 1000 * 1000;     /* timestamps lag changes by a clock tick */
+static const gint64 directory_mtime_coarse_margin_ns = 2000 * 1000 * 1000;
+
+static const size_t arena_block_size        = 16 * 1024;
+static const size_t arena_alignment         = sizeof (void *);
+
+/* names of TCLLN_MEMORY_* areas in tclln::memory stats */
+static const char *memory_area_names [TCLLN_MEMORY_AREAS] = {
+    "completion_strings", "completion_arg_strings", "completion_arg_table", "history", "line_buffer", "result_buffer",
+    "command_index", "variable_index", "directory_cache", "script_cache"
+};
+
+static const unsigned long profile_default_interval_us = 1000;
+static const unsigned long profile_min_interval_us     = 100;
+static const int           profile_max_overhead        = 5;     /* percent of run time spent sampling */
+
+/* default_completions, default_completion_index */
+#include "completion_defaults.h"
+
+/* output channel: appends everything to a GString - instance data points to the GString pointer */
+static const Tcl_ChannelType output_channel_type = {
+    "tclln_output",             /* typeName */
+    TCL_CHANNEL_VERSION_5,      /* version */
+    output_channel_close,       /* closeProc */
+    output_channel_input,       /* inputProc */
+    output_channel_output,      /* outputProc */
+    NULL,                       /* seekProc */
+    NULL,                       /* setOptionProc */
+    NULL,                       /* getOptionProc */
+    output_channel_watch,       /* watchProc */
+    output_channel_get_handle,  /* getHandleProc */
+    NULL,                       /* close2Proc */
+    NULL,                       /* blockModeProc */
+    NULL,                       /* flushProc */
+    NULL,                       /* handlerProc */
+    NULL,                       /* wideSeekProc */
+    NULL,                       /* threadActionProc */
+    NULL                        /* truncateProc */
+};
+
+/* shell output: passes everything to the std channel below - instance data is a struct shell_output */
+static const Tcl_ChannelType shell_output_type = {
+    "tclln_shell_output",       /* typeName */
+    TCL_CHANNEL_VERSION_5,      /* version */
+    shell_output_close,         /* closeProc */
+    shell_output_input,         /* inputProc */
+    shell_output_output,        /* outputProc */
+    NULL,                       /* seekProc */
+    NULL,                       /* setOptionProc */
+    NULL,                       /* getOptionProc */
+    shell_output_watch,         /* watchProc */
+    shell_output_get_handle,    /* getHandleProc */
+    NULL,                       /* close2Proc */
+    NULL,                       /* blockModeProc */
+    NULL,                       /* flushProc */
+    NULL,                       /* handlerProc */
+    NULL,                       /* wideSeekProc */
+    NULL,                       /* threadActionProc */
+    NULL                        /* truncateProc */
+};
+
 /*************************************************
  * global data
  *************************************************/
 
 static struct tclln_data *tclln_completion;
 
+/* allocator of tclln and linenoise - see tclln_set_allocator */
+static void *(*alloc_malloc) (size_t size)             = malloc;
+static void *(*alloc_realloc) (void *ptr, size_t size) = realloc;
+static void (*alloc_free) (void *ptr)                  = free;
+
+/* conversion of profile_clock to ns - set by profile_clock_init */
+static double profile_clock_ns_per_tick;
+
+/* marked by SIGINT while an interactive command is running - the signal handler is process-wide, so
+ * only one instance at a time installs it: interrupt_mutex protects the owner */
+static Tcl_AsyncHandler  interrupt_async_pending;
+static struct tclln_data *interrupt_owner;
+static GMutex            interrupt_mutex;
+
 /*************************************************
  * init / free
  *************************************************/
 
 struct tclln_data * tclln_new (const char *prog_name)
 {
-    struct tclln_data *tclln = (struct tclln_data *) malloc (sizeof (struct tclln_data));
+    return tclln_new_with_options (prog_name, 0);
+}
+
+struct tclln_data * tclln_new_with_options (const char *prog_name, int options)
+{
+    struct tclln_data *tclln = (struct tclln_data *) alloc_malloc (sizeof (struct tclln_data));
     if (tclln == NULL) return NULL;
 
     /* data */
+    tclln->options                 = options;
+    tclln->init_pending            = false;
     tclln->multiline               = false;
+    tclln->single_row              = false;
     tclln->prompt_string_main      = default_prompt_main;
     tclln->prompt_string_multiline = default_prompt_multiline;
+    tclln->shell                   = NULL;
+
+    tclln->result_buffer       = NULL;
+    arena_init (&tclln->eval_arena, arena_block_size);
+    arena_init (&tclln->completion_arena, arena_block_size);
+    tclln->result_max_bytes    = 0;
+    tclln->result_max_elements = 0;
+
+    tclln->hotspot_top_n  = 0;
+    tclln->hotspot_memory = false;
+    tclln->hotspots       = NULL;
+    tclln->hotspot_depth  = 0;
+    tclln->hotspot_line   = 1;
+
+    tclln->interrupt_async     = NULL;
+    tclln->evaluating          = 0;
+    tclln->interrupt_sigint    = false;
+    tclln->interrupt_installed = false;
+    tclln->command_timeout_ms  = 0;
+    tclln->watchdog            = NULL;
+    tclln->watchdog_deadline   = 0;
+    tclln->watchdog_quit       = false;
+    g_mutex_init (&tclln->watchdog_mutex);
+    g_cond_init (&tclln->watchdog_cond);
+
+    tclln->profile_thread      = NULL;
+    tclln->profile_async       = NULL;
+    tclln->profile_stacks      = NULL;
+    tclln->profile_stack       = NULL;
+    tclln->profile_interval_us = 0;
+    tclln->profile_ticks       = 0;
+    tclln->profile_cost_us     = 0;
+    tclln->profile_quit        = false;
+    g_mutex_init (&tclln->profile_mutex);
+    g_cond_init (&tclln->profile_cond);
 
     tclln->tcl_interp             = NULL;
     tclln->completion_begin       = NULL;
-    tclln->completion_list        = NULL;
-    tclln->completion_strings     = NULL;
+    tclln->completion_candidates  = NULL;
     tclln->completion_arg_strings = NULL;
     tclln->completion_arg_table   = NULL;
 
+    tclln->command_index.namespaces  = NULL;
+    tclln->command_index.strings     = NULL;
+    tclln->command_index.qualified   = NULL;
+    tclln->command_index.qualified_strings = NULL;
+    tclln->variable_index.namespaces = NULL;
+    tclln->variable_index.arrays     = NULL;
+    tclln->variable_index.strings    = NULL;
+    tclln->index_epoch               = 0;
+    tclln->index_epoch_step          = 0;
+    tclln->index_generation          = 1;
+    tclln->directory_cache           = NULL;
+    tclln->directory_cache_bytes     = 0;
+    g_queue_init (&tclln->directory_lru);
+    tclln->directory_scans           = NULL;
+    tclln->completion_budget_ms      = default_completion_budget_ms;
+    tclln->fuzzy_completion          = false;
+    g_mutex_init (&tclln->directory_scan_mutex);
+    g_cond_init (&tclln->directory_scan_cond);
+
+    tclln->commands                = NULL;
+    tclln->completion_command_name = NULL;
+
+    tclln->script_cache        = NULL;
+    tclln->script_cache_bytes  = 0;
+    g_queue_init (&tclln->script_lru);
+    tclln->script_cache_hits   = 0;
+    tclln->script_cache_misses = 0;
+    tclln->source_proc         = NULL;
+    tclln->source_client_data  = NULL;
+
     tclln->return_code = 0;
     tclln->exit_tcl    = false;
+    tclln->exit_unwind = false;
+
+    tclln->parallel_isolated = false;
+
+    tclln->time_create_interp = 0;
+    tclln->time_encoding      = 0;
+    tclln->time_init          = 0;
+    tclln->time_completion    = 0;
 
     /* tcl interpreter */
+    struct timespec t_start = time_now ();
+
     tclln->tcl_interp = Tcl_CreateInterp();
 
     if (tclln->tcl_interp == NULL) goto tclln_init_error;
     Tcl_Preserve (tclln->tcl_interp);
 
+    tclln->time_create_interp = time_elapsed_ns (t_start);
+
     /* set utf-8 as system encoding */
-    if (Tcl_Eval (tclln->tcl_interp, "encoding system utf-8\n") != TCL_OK) {
+    t_start = time_now ();
+
+    if (Tcl_SetSystemEncoding (tclln->tcl_interp, "utf-8") != TCL_OK) {
         fprintf(stderr, "Error: could not set system encoding to utf-8\n");
     }
 
+    tclln->time_encoding = time_elapsed_ns (t_start);
+
     /* init script */
-    if (Tcl_Init (tclln->tcl_interp) == TCL_ERROR) {
-        fprintf(stderr, "Error: could not source init script\n");
+    if (options & TCLLN_LAZY_INIT) {
+        /* source init script when unknown commands or packages are looked up or auto_path is read */
+        tclln->init_pending = true;
+
+        Tcl_CreateObjCommand (tclln->tcl_interp, "::unknown", lazy_unknown_command, (ClientData) tclln, NULL);
+        Tcl_CreateObjCommand (tclln->tcl_interp, "::tclln::lazy_package_unknown", lazy_package_unknown_command, (ClientData) tclln, NULL);
+        Tcl_CreateObjCommand (tclln->tcl_interp, "::tclln::lazy_init", lazy_init_command, (ClientData) tclln, NULL);
+
+        Tcl_TraceVar2 (tclln->tcl_interp, "::auto_path", NULL, TCL_GLOBAL_ONLY | TCL_TRACE_READS, lazy_auto_path_trace, (ClientData) tclln);
+
+        /* clock subcommands are auto-loaded: source init library on first use of clock */
+        if (Tcl_Eval (tclln->tcl_interp, "rename ::clock ::tclln::lazy_clock") == TCL_OK) {
+            Tcl_CreateObjCommand (tclln->tcl_interp, "::clock", lazy_clock_command, (ClientData) tclln, NULL);
+        }
+
+        if (Tcl_Eval (tclln->tcl_interp, "package unknown ::tclln::lazy_package_unknown") != TCL_OK) {
+            lazy_init (tclln);
+        }
+    } else {
+        t_start = time_now ();
+
+        if (init_library (tclln) == TCL_ERROR) {
+            fprintf(stderr, "Error: could not source init script\n");
+        }
+
+        tclln->time_init = time_elapsed_ns (t_start);
     }
 
-    /* completion */
-    tclln->completion_begin   = g_string_new (NULL);
-    tclln->completion_strings = g_string_chunk_new (32);
+    Tcl_CreateObjCommand (tclln->tcl_interp, "tclln::profile", profile_command, (ClientData) tclln, NULL);
+    Tcl_CreateObjCommand (tclln->tcl_interp, "tclln::memory", memory_command, (ClientData) tclln, NULL);
+
+    if (options & TCLLN_PROFILE_COMMANDS) {
+        profile_clock_init ();
+        Tcl_CreateObjCommand (tclln->tcl_interp, "tclln::command_stats", profile_command_stats_command, (ClientData) tclln, NULL);
+    }
+
+    /* completion - default arguments are static (see completion_defaults.txt) */
+    t_start = time_now ();
+
+    tclln->completion_begin      = g_string_new (NULL);
+    tclln->completion_candidates = g_ptr_array_new ();
 
     if (tclln->completion_begin == NULL) {
         goto tclln_init_error;
     }
-    if (tclln->completion_strings == NULL) goto tclln_init_error;
+    if (tclln->completion_candidates == NULL) goto tclln_init_error;
+
+    tclln->directory_scans = g_ptr_array_new ();
+
+    if (tclln->directory_scans == NULL) goto tclln_init_error;
 
     tclln->completion_arg_strings = g_string_chunk_new (32);
-    tclln->completion_arg_table   = g_tree_new ((GCompareFunc) strcmp);
+    tclln->completion_arg_table   = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, completion_table_free_args);
 
     if (tclln->completion_arg_strings == NULL) goto tclln_init_error;
     if (tclln->completion_arg_table   == NULL) goto tclln_init_error;
 
-    completion_table_add_defaults (tclln);
+    tclln->time_completion = time_elapsed_ns (t_start);
+
+    /* custom commands */
+    tclln->commands = g_ptr_array_new_with_free_func (command_registration_free);
+
+    if (tclln->commands == NULL) goto tclln_init_error;
+
+    /* script cache */
+    tclln->script_cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, script_cache_entry_free);
+
+    if (tclln->script_cache == NULL) goto tclln_init_error;
 
     /* exit */
     Tcl_CreateObjCommand (tclln->tcl_interp, "exit", exit_command, (ClientData) tclln, NULL);
@@ -171,6 +893,41 @@ void tclln_free (struct tclln_data *tclln)
 {
     if (tclln == NULL) return;
 
+    tclln_profile_stop (tclln);
+
+    if (tclln->profile_async != NULL) {
+        Tcl_AsyncDelete (tclln->profile_async);
+    }
+    if (tclln->profile_stacks != NULL) {
+        g_hash_table_destroy (tclln->profile_stacks);
+    }
+    if (tclln->profile_stack != NULL) {
+        g_string_free (tclln->profile_stack, true);
+    }
+    g_cond_clear (&tclln->profile_cond);
+    g_mutex_clear (&tclln->profile_mutex);
+
+    if (tclln->watchdog != NULL) {
+        g_mutex_lock (&tclln->watchdog_mutex);
+        tclln->watchdog_quit = true;
+        g_cond_signal (&tclln->watchdog_cond);
+        g_mutex_unlock (&tclln->watchdog_mutex);
+
+        g_thread_join (tclln->watchdog);
+    }
+    g_cond_clear (&tclln->watchdog_cond);
+    g_mutex_clear (&tclln->watchdog_mutex);
+
+    if (tclln->interrupt_async != NULL) {
+        Tcl_AsyncDelete (tclln->interrupt_async);
+    }
+    alloc_free (tclln->result_buffer);
+
+    /* cached scripts hold objects of the interpreter */
+    if (tclln->script_cache != NULL) {
+        g_hash_table_destroy (tclln->script_cache);
+        g_queue_clear (&tclln->script_lru);
+    }
     if (tclln->tcl_interp != NULL) {
         Tcl_DeleteInterp (tclln->tcl_interp);
         Tcl_Release (tclln->tcl_interp);
@@ -179,709 +936,5226 @@ void tclln_free (struct tclln_data *tclln)
     if (tclln->completion_begin != NULL) {
         g_string_free (tclln->completion_begin, true);
     }
-    if (tclln->completion_list != NULL) {
-        g_list_free (tclln->completion_list);
-    }
-    if (tclln->completion_strings != NULL) {
-        g_string_chunk_free (tclln->completion_strings);
+    if (tclln->completion_candidates != NULL) {
+        g_ptr_array_free (tclln->completion_candidates, true);
     }
+    arena_free (&tclln->completion_arena);
+    arena_free (&tclln->eval_arena);
     if (tclln->completion_arg_table != NULL) {
-        g_tree_foreach (tclln->completion_arg_table, free_glist_value_in_tree, NULL);
-        g_tree_destroy (tclln->completion_arg_table);
+        g_hash_table_destroy (tclln->completion_arg_table);
     }
     if (tclln->completion_arg_strings != NULL) {
         g_string_chunk_free (tclln->completion_arg_strings);
     }
+    command_index_free (&tclln->command_index);
+    variable_index_free (tclln);
+    directory_scans_free (tclln);
+    directory_cache_free (tclln);
+    g_cond_clear (&tclln->directory_scan_cond);
+    g_mutex_clear (&tclln->directory_scan_mutex);
+    if (tclln->commands != NULL) {
+        g_ptr_array_unref (tclln->commands);
+    }
+    if (tclln->completion_command_name != NULL) {
+        g_free (tclln->completion_command_name);
+    }
 
-    free (tclln);
+    alloc_free (tclln);
 }
 
-static gboolean free_glist_value_in_tree (gpointer key, gpointer value, gpointer data)
+/* new TclLN with the custom commands of tclln - for other threads or pools */
+static struct tclln_data *tclln_new_like (struct tclln_data *tclln, int options)
 {
-    GList *list = (GList *) value;
+    struct tclln_data *instance = tclln_new_with_options (NULL, options);
+    if (instance == NULL) return NULL;
 
-    if (list != NULL) {
-        g_list_free (list);
+    for (guint i = 0; i < tclln->commands->len; i++) {
+        struct command_registration *command = (struct command_registration *) g_ptr_array_index (tclln->commands, i);
+
+        /* delete procs stay with the original interpreter */
+        tclln_add_command (instance, command->name, (const char * const *) command->arg_complete_list,
+                command->proc, command->client_data, NULL);
+    }
+
+    if (tclln->completion_command_name != NULL) {
+        tclln_provide_completion_command (instance, tclln->completion_command_name);
+    }
+    if (tclln->source_proc != NULL) {
+        tclln_provide_cached_source (instance);
     }
 
-    return false;
+    return instance;
 }
 
 /*************************************************
- * run
+ * init library
  *************************************************/
 
-bool tclln_run (struct tclln_data *tclln)
+#ifdef TCLLN_EMBED_INIT
+/* init.tcl embedded at build time */
+static const char tclln_init_script [] =
+#include "tclln_init.h"
+;
+#endif
+
+void tclln_startup_times (struct tclln_data *tclln, unsigned long *create_interp_ns, unsigned long *encoding_ns,
+                unsigned long *init_ns, unsigned long *completion_ns)
 {
-    /* for multi-line inputs */
-    GString *gs_input = g_string_new (NULL);
+    if (tclln == NULL) return;
 
-    /* prepare linenoise for interaction with this */
-    tclln_completion = tclln;
-    linenoiseSetCompletionCallback (completion);
-    linenoiseSetMultiLine (1);
-    linenoiseHistorySetMaxLen (default_history_size);
+    if (create_interp_ns != NULL) *create_interp_ns = tclln->time_create_interp;
+    if (encoding_ns      != NULL) *encoding_ns      = tclln->time_encoding;
+    if (init_ns          != NULL) *init_ns          = tclln->time_init;
+    if (completion_ns    != NULL) *completion_ns    = tclln->time_completion;
+}
 
-    while (true) {
-        if (tclln->exit_tcl) {
-            break;
-        }
+static int init_library (struct tclln_data *tclln)
+{
+#ifdef TCLLN_EMBED_INIT
+    /* no search for init.tcl: library directory is known at build time */
+    if (Tcl_GetVar2 (tclln->tcl_interp, "tcl_library", NULL, TCL_GLOBAL_ONLY) == NULL) {
+        Tcl_SetVar2 (tclln->tcl_interp, "tcl_library", NULL, TCLLN_TCL_LIBRARY, TCL_GLOBAL_ONLY);
+    }
 
-        char *line = linenoise (prompt (tclln));
+    return Tcl_EvalEx (tclln->tcl_interp, tclln_init_script, -1, TCL_EVAL_GLOBAL);
+#else
+    return Tcl_Init (tclln->tcl_interp);
+#endif
+}
 
-        if (line == NULL) {
-            if (errno == EAGAIN) {
-                continue;
-            }
-            break;
-        }
+/* source init library if still pending - stays pending if it fails */
+static int lazy_init (struct tclln_data *tclln)
+{
+    if (!tclln->init_pending) return TCL_OK;
 
-        if (strlen (line) > 0) {
-            linenoiseHistoryAdd (line);
-        }
+    /* lookups by the init script itself do not start it again */
+    tclln->init_pending = false;
 
-        /* multiline? */
-        if (tclln->multiline) {
-            gs_input = g_string_append (gs_input, "\n");
-            gs_input = g_string_append (gs_input, line);
+    struct timespec t_start = time_now ();
 
-            linenoiseFree (line);
-            line     = gs_input->str;
-        }
+    /* keep result of the command that triggered init */
+    Tcl_InterpState state = Tcl_SaveInterpState (tclln->tcl_interp, TCL_OK);
 
-        bool brace_match = (Tcl_CommandComplete (line) == 1 ? true : false);
+    /* lookup may come from a proc or namespace (e.g. ::tcl::clock): init runs at global level */
+    int tcl_res = Tcl_EvalEx (tclln->tcl_interp, "::tclln::lazy_init", -1, TCL_EVAL_GLOBAL);
 
-        if (!brace_match) {
-            if (!tclln->multiline) {
-                gs_input = g_string_append (gs_input, line);
-                linenoiseFree (line);
-                tclln->multiline = true;
-            }
+    if (tcl_res == TCL_ERROR) {
+        fprintf(stderr, "Error: could not source init script\n");
+        tclln->init_pending = true;
+    } else {
+        Tcl_UntraceVar2 (tclln->tcl_interp, "::auto_path", NULL, TCL_GLOBAL_ONLY | TCL_TRACE_READS, lazy_auto_path_trace, (ClientData) tclln);
+        Tcl_DeleteCommand (tclln->tcl_interp, "::tclln::lazy_init");
+        lazy_clock_restore (tclln);
+    }
 
-            continue;
-        }
+    Tcl_RestoreInterpState (tclln->tcl_interp, state);
 
-        int tcl_res = Tcl_Eval (tclln->tcl_interp, line);
+    tclln->time_init += time_elapsed_ns (t_start);
 
-        const char *result_string = Tcl_GetString (Tcl_GetObjResult (tclln->tcl_interp));
+    return tcl_res;
+}
 
-        if (strlen (result_string) > 0) {
-            fprintf ((tcl_res == TCL_OK ? stdout : stderr), "%s\n", result_string);
-        }
+/* evaluated at global level by lazy_init */
+static int lazy_init_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
 
-        /* end of multiline */
-        if (tclln->multiline) {
-            tclln->multiline = false;
-            gs_input = g_string_assign (gs_input, "");
-        } else {
-            linenoiseFree (line);
+    return init_library (tclln);
+}
+
+/* clock before init: source init library and pass on to clock
+ * (an unknown subcommand of clock is looked up with the global frame in namespace ::tcl::clock - too late for init) */
+static int lazy_clock_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    lazy_init (tclln);
+    lazy_clock_restore (tclln);
+
+    return Tcl_EvalObjv (interp, objc, objv, 0);
+}
+
+/* put clock back in place of lazy_clock_command */
+static void lazy_clock_restore (struct tclln_data *tclln)
+{
+    Tcl_CmdInfo clock_info;
+    if ((Tcl_GetCommandInfo (tclln->tcl_interp, "::clock", &clock_info) == 0) || (clock_info.objProc != lazy_clock_command)) return;
+
+    Tcl_DeleteCommand (tclln->tcl_interp, "::clock");
+
+    Tcl_InterpState state = Tcl_SaveInterpState (tclln->tcl_interp, TCL_OK);
+    Tcl_Eval (tclln->tcl_interp, "rename ::tclln::lazy_clock ::clock");
+    Tcl_RestoreInterpState (tclln->tcl_interp, state);
+}
+
+/* auto_path read before init: source init library, which sets it */
+static char *lazy_auto_path_trace (ClientData client_data, Tcl_Interp *interp, const char *name1, const char *name2, int flags)
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    lazy_init (tclln);
+
+    return NULL;
+}
+
+/* unknown before init: source init library and pass on to its unknown */
+static int lazy_unknown_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    lazy_init (tclln);
+
+    Tcl_CmdInfo unknown_info;
+    if ((Tcl_GetCommandInfo (interp, "::unknown", &unknown_info) == 0) || (unknown_info.objProc == lazy_unknown_command)) {
+        /* init failed: behave like tcl without unknown */
+        Tcl_SetObjResult (interp, Tcl_ObjPrintf ("invalid command name \"%s\"", (objc > 1 ? Tcl_GetString (objv[1]) : "")));
+        return TCL_ERROR;
+    }
+
+    return Tcl_EvalObjv (interp, objc, objv, 0);
+}
+
+/* package unknown before init: source init library and pass on to its package unknown */
+static int lazy_package_unknown_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    lazy_init (tclln);
+
+    if (Tcl_Eval (interp, "package unknown") != TCL_OK) return TCL_ERROR;
+
+    Tcl_Obj *command = Tcl_DuplicateObj (Tcl_GetObjResult (interp));
+    Tcl_IncrRefCount (command);
+    Tcl_ResetResult (interp);
+
+    int tcl_res = TCL_OK;
+
+    /* init failed: nothing to do (like empty package unknown) */
+    int length = 0;
+    Tcl_ListObjLength (NULL, command, &length);
+
+    if ((length > 0) && (strcmp (Tcl_GetString (command), "::tclln::lazy_package_unknown") != 0)) {
+        for (int i = 1; i < objc; i++) {
+            Tcl_ListObjAppendElement (NULL, command, objv[i]);
         }
+        tcl_res = Tcl_EvalObjEx (interp, command, TCL_EVAL_GLOBAL);
     }
 
-    g_string_free (gs_input, true);
+    Tcl_DecrRefCount (command);
 
-    return true;
+    return tcl_res;
 }
 
+/*************************************************
+ * time measurement
+ *************************************************/
 
-#define FILE_BUF_LEN 1024
-bool tclln_run_file (struct tclln_data *tclln, const char *script_name, bool verbose)
+static struct timespec time_now (void)
 {
-    /* check for filename */
-    if (script_name == NULL) {
-        fprintf (stderr, "Error: no filename specified\n");
-        return false;
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+
+    return now;
+}
+
+static unsigned long time_elapsed_ns (struct timespec t_start)
+{
+    struct timespec t_end = time_now ();
+
+    return (t_end.tv_sec - t_start.tv_sec) * 1000000000UL + t_end.tv_nsec - t_start.tv_nsec;
+}
+
+/*************************************************
+ * pool
+ *************************************************/
+
+/* Interpreters can only be used by the thread that created them, so the pool
+ * is refilled from the idle handlers of the tcl event loop of that thread
+ * (or explicitly by tclln_pool_refill) rather than by a thread of its own. */
+
+struct tclln_pool *tclln_pool_new (struct tclln_data *tclln, int size)
+{
+    if (tclln == NULL) return NULL;
+
+    struct tclln_pool *pool = (struct tclln_pool *) alloc_malloc (sizeof (struct tclln_pool));
+    if (pool == NULL) return NULL;
+
+    pool->tclln            = tclln;
+    pool->size             = (size > 0 ? size : 1);
+    pool->instances        = g_ptr_array_sized_new (pool->size);
+    pool->refill_scheduled = false;
+
+    pool->acquires         = 0;
+    pool->misses           = 0;
+    pool->latency_sum      = 0;
+    pool->latency_max      = 0;
+
+    tclln_pool_refill (pool);
+
+    return pool;
+}
+
+void tclln_pool_free (struct tclln_pool *pool)
+{
+    if (pool == NULL) return;
+
+    if (pool->refill_scheduled) {
+        Tcl_CancelIdleCall (pool_refill_idle, (ClientData) pool);
     }
 
-    /* try to open file */
-    FILE *infile = fopen (script_name, "r");
-    if (infile == NULL) {
-        fprintf (stderr, "Error: failed to open file %s\n", script_name);
-        return false;
+    for (guint i = 0; i < pool->instances->len; i++) {
+        tclln_free ((struct tclln_data *) g_ptr_array_index (pool->instances, i));
+    }
+    g_ptr_array_free (pool->instances, true);
+
+    alloc_free (pool);
+}
+
+struct tclln_data *tclln_pool_acquire (struct tclln_pool *pool)
+{
+    if (pool == NULL) return NULL;
+
+    struct timespec t_start = time_now ();
+
+    struct tclln_data *tclln;
+
+    if (pool->instances->len > 0) {
+        tclln = (struct tclln_data *) g_ptr_array_remove_index (pool->instances, pool->instances->len - 1);
+    } else {
+        /* pool exhausted: initialize a new instance now */
+        tclln = tclln_new_like (pool->tclln, pool->tclln->options);
+        pool->misses++;
+    }
+
+    unsigned long latency = time_elapsed_ns (t_start);
+
+    pool->acquires++;
+    pool->latency_sum += latency;
+    if (latency > pool->latency_max) {
+        pool->latency_max = latency;
+    }
+
+    pool_schedule_refill (pool);
+
+    return tclln;
+}
+
+void tclln_pool_refill (struct tclln_pool *pool)
+{
+    if (pool == NULL) return;
+
+    while (pool->instances->len < (guint) pool->size) {
+        struct tclln_data *tclln = tclln_new_like (pool->tclln, pool->tclln->options);
+        if (tclln == NULL) break;
+
+        g_ptr_array_add (pool->instances, tclln);
     }
+}
+
+void tclln_pool_stats (struct tclln_pool *pool, unsigned long *acquires, unsigned long *misses,
+                unsigned long *latency_avg_ns, unsigned long *latency_max_ns)
+{
+    if (pool == NULL) return;
+
+    if (acquires       != NULL) *acquires       = pool->acquires;
+    if (misses         != NULL) *misses         = pool->misses;
+    if (latency_avg_ns != NULL) *latency_avg_ns = (pool->acquires > 0 ? pool->latency_sum / pool->acquires : 0);
+    if (latency_max_ns != NULL) *latency_max_ns = pool->latency_max;
+}
+
+static void pool_schedule_refill (struct tclln_pool *pool)
+{
+    if (pool->refill_scheduled) return;
+    if (pool->instances->len >= (guint) pool->size) return;
+
+    Tcl_DoWhenIdle (pool_refill_idle, (ClientData) pool);
+    pool->refill_scheduled = true;
+}
+
+/* add one instance per idle call - keeps the event loop responsive */
+static void pool_refill_idle (ClientData client_data)
+{
+    struct tclln_pool *pool = (struct tclln_pool *) client_data;
+
+    pool->refill_scheduled = false;
+
+    if (pool->instances->len < (guint) pool->size) {
+        struct tclln_data *tclln = tclln_new_like (pool->tclln, pool->tclln->options);
+        if (tclln == NULL) return;
+
+        g_ptr_array_add (pool->instances, tclln);
+    }
+
+    pool_schedule_refill (pool);
+}
+
+/*************************************************
+ * run
+ *************************************************/
+
+bool tclln_run (struct tclln_data *tclln)
+{
+    /* the shell handles Ctrl-C */
+    bool interrupt_sigint = tclln->interrupt_sigint;
+    tclln->interrupt_sigint = true;
+
+    /* no terminal: no line editing needed */
+    if (!isatty (STDIN_FILENO)) {
+        bool result = run_pipe (tclln, STDIN_FILENO);
+
+        tclln->interrupt_sigint = interrupt_sigint;
+
+        return result;
+    }
+
+    struct shell_state shell;
+
+    shell.editing = false;
+    shell.hidden  = false;
+    shell.done    = false;
+    shell.input   = Tcl_GetStdChannel (TCL_STDIN);
+    shell.lines   = g_string_new (NULL);
+    command_scanner_init (&shell.scanner);
+
+    tclln->shell = &shell;
+
+    /* prepare linenoise for interaction with this */
+    tclln_completion = tclln;
+    linenoiseSetCompletionCallback (completion);
+    linenoiseSetMultiLine (tclln->single_row ? 0 : 1);
+    linenoiseHistorySetMaxLen (default_history_size);
+
+    if ((shell.input != NULL) && shell_edit_start (tclln)) {
+        /* input is fed to linenoise whenever stdin is readable - timers, file events
+         * and sockets are served while waiting for input */
+        shell_output_stack (tclln);
+        Tcl_CreateChannelHandler (shell.input, TCL_READABLE, shell_input_handler, (ClientData) tclln);
+
+        while (!shell.done && !tclln->exit_tcl) {
+            Tcl_DoOneEvent (TCL_ALL_EVENTS);
+        }
+
+        Tcl_DeleteChannelHandler (shell.input, shell_input_handler, (ClientData) tclln);
+        Tcl_CancelIdleCall (shell_show_idle, (ClientData) tclln);
+
+        if (shell.editing) {
+            linenoiseEditStop (&shell.edit);
+        }
+        shell_output_unstack (tclln);
+    } else {
+        /* unsupported terminal: blocking line input */
+        while (!tclln->exit_tcl) {
+            char *line = linenoise (prompt (tclln));
+
+            if (line == NULL) {
+                if (errno == EAGAIN) {
+                    continue;
+                }
+                break;
+            }
+
+            shell_line (tclln, line);
+        }
+    }
+
+    tclln->shell            = NULL;
+    tclln->interrupt_sigint = interrupt_sigint;
+
+    g_string_free (shell.lines, true);
+    command_scanner_free (&shell.scanner);
+
+    return true;
+}
+
+/* returns false if the terminal does not support line editing */
+static bool shell_edit_start (struct tclln_data *tclln)
+{
+    struct shell_state *shell = tclln->shell;
+
+    if (linenoiseEditStart (&shell->edit, STDIN_FILENO, STDOUT_FILENO, prompt (tclln)) != 0) {
+        return false;
+    }
+
+    shell->editing = true;
+    shell->hidden  = false;
+
+    return true;
+}
+
+static void shell_input_handler (ClientData client_data, int mask)
+{
+    struct tclln_data  *tclln = (struct tclln_data *) client_data;
+    struct shell_state *shell = tclln->shell;
+
+    if (!shell->editing) return;
+
+    /* typing shows the prompt immediately */
+    if (shell->hidden) {
+        Tcl_CancelIdleCall (shell_show_idle, client_data);
+        shell_show_idle (client_data);
+    }
+
+    char *line = linenoiseEditFeed (&shell->edit);
+
+    if (line == linenoiseEditMore) return;
+
+    linenoiseEditStop (&shell->edit);
+    shell->editing = false;
+
+    if (line == NULL) {
+        if (errno != EAGAIN) {
+            shell->done = true;
+            return;
+        }
+    } else {
+        /* no input while the command runs (e.g. in vwait) */
+        Tcl_DeleteChannelHandler (shell->input, shell_input_handler, client_data);
+
+        shell_line (tclln, line);
+
+        Tcl_CreateChannelHandler (shell->input, TCL_READABLE, shell_input_handler, client_data);
+    }
+
+    if (!tclln->exit_tcl && !shell_edit_start (tclln)) {
+        shell->done = true;
+    }
+}
+
+/* line entered: evaluate complete command - takes ownership of line */
+static void shell_line (struct tclln_data *tclln, char *line)
+{
+    struct shell_state *shell = tclln->shell;
+
+    if (strlen (line) > 0) {
+        linenoiseHistoryAdd (line);
+    }
+
+    /* multiline? */
+    if (tclln->multiline) {
+        command_scanner_feed (&shell->scanner, "\n", 1);
+        command_scanner_feed (&shell->scanner, line, strlen (line));
+
+        shell->lines = g_string_append (shell->lines, "\n");
+        shell->lines = g_string_append (shell->lines, line);
+
+        linenoiseFree (line);
+        line         = shell->lines->str;
+    } else {
+        command_scanner_feed (&shell->scanner, line, strlen (line));
+    }
+
+    bool brace_match = command_scanner_complete (&shell->scanner);
+
+    if (!brace_match) {
+        if (!tclln->multiline) {
+            shell->lines = g_string_append (shell->lines, line);
+            linenoiseFree (line);
+            tclln->multiline = true;
+        }
+
+        return;
+    }
+
+    /* evaluated as object: cancellation is reset when the command is unwound */
+    Tcl_Obj *command = Tcl_NewStringObj (line, -1);
+    Tcl_IncrRefCount (command);
+
+    interrupt_begin (tclln);
+    int tcl_res = Tcl_EvalObjEx (tclln->tcl_interp, command, 0);
+    interrupt_end (tclln);
+
+    Tcl_DecrRefCount (command);
+
+    result_print (tclln, (tcl_res == TCL_OK ? stdout : stderr));
+
+    command_scanner_reset (&shell->scanner);
+
+    /* end of multiline */
+    if (tclln->multiline) {
+        tclln->multiline = false;
+        shell->lines     = g_string_assign (shell->lines, "");
+    } else {
+        linenoiseFree (line);
+    }
+}
+
+static void shell_show_idle (ClientData client_data)
+{
+    struct tclln_data  *tclln = (struct tclln_data *) client_data;
+    struct shell_state *shell = tclln->shell;
+
+    if ((shell == NULL) || !shell->hidden) return;
+
+    shell->hidden = false;
+
+    if (shell->editing) {
+        linenoiseShow (&shell->edit);
+    }
+}
+
+static void shell_output_stack (struct tclln_data *tclln)
+{
+    const int types [] = {TCL_STDOUT, TCL_STDERR};
+
+    for (int i = 0; i < 2; i++) {
+        struct shell_output *output = &tclln->shell->outputs[i];
+
+        output->tclln   = tclln;
+        output->channel = NULL;
+
+        Tcl_Channel std_channel = Tcl_GetStdChannel (types[i]);
+        if (std_channel == NULL) continue;
+
+        output->channel = Tcl_StackChannel (tclln->tcl_interp, &shell_output_type, (ClientData) output,
+                                            TCL_WRITABLE, std_channel);
+    }
+}
+
+static void shell_output_unstack (struct tclln_data *tclln)
+{
+    for (int i = 0; i < 2; i++) {
+        struct shell_output *output = &tclln->shell->outputs[i];
+
+        if (output->channel == NULL) continue;
+
+        Tcl_UnstackChannel (tclln->tcl_interp, output->channel);
+        output->channel = NULL;
+    }
+}
+
+static int shell_output_close (ClientData instance_data, Tcl_Interp *interp)
+{
+    return 0;
+}
+
+static int shell_output_input (ClientData instance_data, char *buf, int to_read, int *error_code)
+{
+    *error_code = EINVAL;
+    return -1;
+}
+
+static int shell_output_output (ClientData instance_data, const char *buf, int to_write, int *error_code)
+{
+    struct shell_output *output = (struct shell_output *) instance_data;
+    struct shell_state  *shell  = output->tclln->shell;
+
+    /* output while editing (timers, file events): clear the prompt, show it again when idle */
+    if ((shell != NULL) && shell->editing && !shell->hidden) {
+        linenoiseHide (&shell->edit);
+        shell->hidden = true;
+        Tcl_DoWhenIdle (shell_show_idle, (ClientData) output->tclln);
+    }
+
+    int written = Tcl_WriteRaw (Tcl_GetStackedChannel (output->channel), buf, to_write);
+    if (written < 0) {
+        *error_code = Tcl_GetErrno ();
+    }
+
+    return written;
+}
+
+static void shell_output_watch (ClientData instance_data, int mask)
+{
+    /* stacked channel: events are generated by the channel below */
+}
+
+static int shell_output_get_handle (ClientData instance_data, int direction, ClientData *handle)
+{
+    struct shell_output *output = (struct shell_output *) instance_data;
+
+    return Tcl_GetChannelHandle (Tcl_GetStackedChannel (output->channel), direction, handle);
+}
+
+
+#define FILE_BUF_LEN 65536
+/* shell input from pipe: evaluated directly from the read buffer - like tclln_run without line editing */
+static bool run_pipe (struct tclln_data *tclln, int fd)
+{
+    size_t buf_size = FILE_BUF_LEN;
+    char   *buf     = alloc_malloc (buf_size);
+    size_t buf_len  = 0;    /* bytes in buffer */
+    size_t scan_pos = 0;    /* bytes already fed to scanner - command starts at 0 */
+
+    struct command_scanner scanner;
+    command_scanner_init (&scanner);
+
+    bool result = true;
+
+    /* Ctrl-C and time limit apply to each command */
+    interrupt_begin (tclln);
+
+    while (!tclln->exit_tcl) {
+        /* incomplete command fills buffer: grow */
+        if (buf_len == buf_size) {
+            buf_size *= 2;
+            buf = alloc_realloc (buf, buf_size);
+        }
+
+        /* wait in poll: it fails with EINTR on Ctrl-C, read is restarted (SA_RESTART) */
+        struct pollfd input = { .fd = fd, .events = POLLIN };
+
+        ssize_t n_read = (poll (&input, 1, -1) < 0) ? -1 : read (fd, buf + buf_len, buf_size - buf_len);
+
+        if (n_read < 0) {
+            if (errno == EINTR) {
+                /* Ctrl-C while waiting for input: stop like without the signal handler */
+                if (Tcl_AsyncReady ()) {
+                    result = false;
+                    break;
+                }
+                continue;
+            }
+
+            fprintf (stderr, "Error: failed to read input\n");
+            result = false;
+            break;
+        }
+
+        /* end of input: last line might not be terminated */
+        if (n_read == 0) {
+            if (scan_pos < buf_len) {
+                command_scanner_feed (&scanner, buf + scan_pos, buf_len - scan_pos);
+
+                if (command_scanner_complete (&scanner)) {
+                    run_pipe_eval (tclln, buf, buf_len);
+                }
+            }
+            break;
+        }
+
+        buf_len += n_read;
+
+        /* evaluate complete commands in buffer */
+        size_t cmd_start = 0;
+
+        while (!tclln->exit_tcl) {
+            const char *line_end = memchr (buf + scan_pos, '\n', buf_len - scan_pos);
+            if (line_end == NULL) break;
+
+            size_t line_len = line_end - (buf + scan_pos);
+            command_scanner_feed (&scanner, buf + scan_pos, line_len + 1);
+            scan_pos += line_len + 1;
+
+            if (!command_scanner_complete (&scanner)) continue;
+
+            run_pipe_eval (tclln, buf + cmd_start, scan_pos - 1 - cmd_start);
+
+            command_scanner_reset (&scanner);
+            cmd_start = scan_pos;
+        }
+
+        /* keep incomplete command for next read */
+        if (cmd_start > 0) {
+            memmove (buf, buf + cmd_start, buf_len - cmd_start);
+            buf_len  -= cmd_start;
+            scan_pos -= cmd_start;
+        }
+    }
+
+    interrupt_end (tclln);
+
+    command_scanner_free (&scanner);
+    alloc_free (buf);
+
+    return result;
+}
+
+static bool run_pipe_eval (struct tclln_data *tclln, const char *command, size_t length)
+{
+    interrupt_next (tclln);
+    int tcl_res = Tcl_EvalEx (tclln->tcl_interp, command, length, 0);
+
+    /* interrupted: next command of the input runs */
+    if (tcl_res == TCL_ERROR) {
+        interrupt_reset (tclln);
+    }
+
+    result_print (tclln, (tcl_res == TCL_OK ? stdout : stderr));
+
+    return (tcl_res == TCL_OK);
+}
+
+bool tclln_run_file (struct tclln_data *tclln, const char *script_name, bool verbose)
+{
+    /* check for filename */
+    if (script_name == NULL) {
+        fprintf (stderr, "Error: no filename specified\n");
+        return false;
+    }
+
+    bool hotspots = hotspot_begin (tclln);
+
+    /* exit stops the running command too */
+    bool exit_unwind = tclln->exit_unwind;
+    tclln->exit_unwind = true;
+
+    /* [info script] names the file while it runs */
+    Tcl_Obj *path = Tcl_NewStringObj (script_name, -1);
+    Tcl_IncrRefCount (path);
+    Tcl_Obj *old_name = script_cache_set_info_script (tclln->tcl_interp, path);
+
+    bool result = run_file (tclln, script_name, verbose);
+
+    if (old_name != NULL) {
+        Tcl_Obj *name = script_cache_set_info_script (tclln->tcl_interp, old_name);
+        if (name != NULL) {
+            Tcl_DecrRefCount (name);
+        }
+        Tcl_DecrRefCount (old_name);
+    }
+    Tcl_DecrRefCount (path);
+
+    tclln->exit_unwind = exit_unwind;
+
+    if (hotspots) {
+        hotspot_end (tclln, script_name);
+    }
+
+    return result;
+}
+
+/* evaluate file command by command - a file is scanned once, commands are evaluated from a
+ * mapping of the file or from the script cache */
+static bool run_file (struct tclln_data *tclln, const char *script_name, bool verbose)
+{
+    /* cached script? */
+    Tcl_Obj *path = Tcl_NewStringObj (script_name, -1);
+    Tcl_IncrRefCount (path);
+
+    struct script_cache_entry *entry = script_cache_lookup (tclln, path, false);
+
+    Tcl_DecrRefCount (path);
+
+    if (entry != NULL) {
+        return run_cached_script (tclln, entry, verbose);
+    }
+
+    /* try to open file */
+    int fd = open (script_name, O_RDONLY);
+    if (fd < 0) {
+        fprintf (stderr, "Error: failed to open file %s\n", script_name);
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat (fd, &file_stat) != 0) {
+        fprintf (stderr, "Error: failed to open file %s\n", script_name);
+        close (fd);
+        return false;
+    }
+
+    /* pipes, devices, ...: cannot be mapped -> read them */
+    if (!S_ISREG (file_stat.st_mode)) {
+        bool result = run_stream (tclln, fd, verbose);
+        close (fd);
+        return result;
+    }
+
+    /* empty file: nothing to do */
+    if (file_stat.st_size == 0) {
+        close (fd);
+        return true;
+    }
+
+    /* map file: commands are evaluated directly from the mapping */
+    size_t length = file_stat.st_size;
+    void  *script = mmap (NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+
+    if (script == MAP_FAILED) {
+        fprintf (stderr, "Error: failed to read file %s\n", script_name);
+        return false;
+    }
+
+    madvise (script, length, MADV_SEQUENTIAL);
+
+    bool result = run_script (tclln, (const char *) script, length, verbose);
+
+    munmap (script, length);
+
+    return result;
+}
+
+bool tclln_run_buffer (struct tclln_data *tclln, const char *script, size_t length)
+{
+    if (script == NULL) {
+        fprintf (stderr, "Error: no script specified\n");
+        return false;
+    }
+
+    return run_script (tclln, script, length, false);
+}
+
+static bool run_stream (struct tclln_data *tclln, int fd, bool verbose)
+{
+    GString *gs_script = g_string_new (NULL);
+    char buf [FILE_BUF_LEN];
+
+    while (true) {
+        ssize_t n_read = read (fd, buf, FILE_BUF_LEN);
+
+        if (n_read == 0) break;
+        if (n_read < 0) {
+            if (errno == EINTR) continue;
+
+            fprintf (stderr, "Error: failed to read script\n");
+            g_string_free (gs_script, true);
+            return false;
+        }
+
+        g_string_append_len (gs_script, buf, n_read);
+    }
+
+    bool result = run_script (tclln, gs_script->str, gs_script->len, verbose);
+
+    g_string_free (gs_script, true);
+
+    return result;
+}
+
+static bool run_script (struct tclln_data *tclln, const char *script, size_t length, bool verbose)
+{
+    const char *script_end = script + length;
+    const char *cmd_start  = script;
+
+    struct command_scanner scanner;
+    command_scanner_init (&scanner);
+
+    /* Ctrl-C and time limit apply to each command */
+    interrupt_begin (tclln);
+
+    bool hotspots = hotspot_recording (tclln);
+
+    while (cmd_start < script_end) {
+        if (tclln->exit_tcl) {
+            break;
+        }
+
+        const char *cmd_end = script_next_command (&scanner, cmd_start, script_end);
+        int         cmd_len = cmd_end - cmd_start;
+
+        /* verbose? print command: */
+        if (verbose) {
+            fwrite (cmd_start, 1, cmd_len, stdout);
+        }
+
+        struct timespec t_start;
+        long            memory_start = 0;
+
+        if (hotspots) {
+            if (tclln->hotspot_memory) {
+                memory_start = memory_in_use ();
+            }
+            t_start = time_now ();
+        }
+
+        /* enough input for script execution: */
+        interrupt_next (tclln);
+        int tcl_res = Tcl_EvalEx (tclln->tcl_interp, cmd_start, cmd_len, 0);
+
+        if (hotspots) {
+            hotspot_record (tclln, cmd_start, cmd_len, t_start, memory_start);
+        }
+
+        /* unwound by exit: no error */
+        if (tclln->exit_tcl) {
+            Tcl_ResetResult (tclln->tcl_interp);
+            break;
+        }
+
+        if (!run_print_result (tclln, tcl_res, verbose)) {
+            break;
+        }
+
+        /* next input */
+        cmd_start = cmd_end;
+    }
+
+    interrupt_end (tclln);
+
+    command_scanner_free (&scanner);
+
+    return true;
+}
+
+static bool run_cached_script (struct tclln_data *tclln, struct script_cache_entry *entry, bool verbose)
+{
+    /* keep commands even if the cache entry is replaced while running */
+    GPtrArray *commands = g_ptr_array_ref (script_cache_commands (tclln, entry));
+
+    interrupt_begin (tclln);
+
+    bool hotspots = hotspot_recording (tclln);
+
+    for (guint i = 0; i < commands->len; i++) {
+        if (tclln->exit_tcl) {
+            break;
+        }
+
+        Tcl_Obj *command = (Tcl_Obj *) g_ptr_array_index (commands, i);
+
+        /* verbose? print command: */
+        if (verbose) {
+            int cmd_len;
+            const char *cmd_str = Tcl_GetStringFromObj (command, &cmd_len);
+
+            fwrite (cmd_str, 1, cmd_len, stdout);
+        }
+
+        struct timespec t_start;
+        long            memory_start = 0;
+
+        if (hotspots) {
+            if (tclln->hotspot_memory) {
+                memory_start = memory_in_use ();
+            }
+            t_start = time_now ();
+        }
+
+        /* compiled on first use, reused afterwards */
+        interrupt_next (tclln);
+        int tcl_res = Tcl_EvalObjEx (tclln->tcl_interp, command, 0);
+
+        if (hotspots) {
+            int cmd_len;
+            const char *cmd_str = Tcl_GetStringFromObj (command, &cmd_len);
+
+            hotspot_record (tclln, cmd_str, cmd_len, t_start, memory_start);
+        }
+
+        /* unwound by exit: no error */
+        if (tclln->exit_tcl) {
+            Tcl_ResetResult (tclln->tcl_interp);
+            break;
+        }
+
+        if (!run_print_result (tclln, tcl_res, verbose)) {
+            break;
+        }
+    }
+
+    interrupt_end (tclln);
+
+    g_ptr_array_unref (commands);
+
+    return true;
+}
+
+/* print result of a command from a script
+ * returns: false if execution of the script should stop */
+static bool run_print_result (struct tclln_data *tclln, int tcl_res, bool verbose)
+{
+    if (verbose || (tcl_res != TCL_OK)) {
+        result_print (tclln, stdout);
+
+        if (tcl_res != TCL_OK) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* find end of the complete command starting at cmd_start
+ * returns: end of command or script_end */
+static const char *script_next_command (struct command_scanner *scanner, const char *cmd_start, const char *script_end)
+{
+    const char *cmd_end = cmd_start;
+
+    command_scanner_reset (scanner);
+
+    while (cmd_end < script_end) {
+        /* extend command by next line */
+        const char *line_start = cmd_end;
+        const char *line_end   = memchr (line_start, '\n', script_end - line_start);
+        cmd_end = (line_end == NULL ? script_end : line_end + 1);
+
+        command_scanner_feed (scanner, line_start, cmd_end - line_start);
+
+        /* no complete tcl command? wait for more input - at end of script take the rest anyway */
+        if (command_scanner_complete (scanner)) {
+            break;
+        }
+    }
+
+    return cmd_end;
+}
+
+/*************************************************
+ * hotspot report
+ *************************************************/
+
+void tclln_set_hotspot_report (struct tclln_data *tclln, int top_n, bool memory)
+{
+    if (tclln == NULL) return;
+
+    tclln->hotspot_top_n  = (top_n > 0 ? top_n : 0);
+    tclln->hotspot_memory = memory;
+}
+
+/* returns: false if disabled or a file is already recorded (nested tclln_run_file) */
+static bool hotspot_begin (struct tclln_data *tclln)
+{
+    if ((tclln->hotspot_top_n == 0) || (tclln->hotspots != NULL)) return false;
+
+    tclln->hotspots      = g_array_new (false, false, sizeof (struct hotspot));
+    tclln->hotspot_line  = 1;
+    tclln->hotspot_depth = tclln->evaluating + 1;  /* run_script or run_cached_script of the file */
+
+    return true;
+}
+
+/* called by run_script and run_cached_script after interrupt_begin
+ * returns: true if they run the file of the report - scripts run by its commands (e.g. tclln_run_buffer
+ *          from a command) count as part of the calling command */
+static bool hotspot_recording (struct tclln_data *tclln)
+{
+    return (tclln->hotspots != NULL) && (tclln->evaluating == tclln->hotspot_depth);
+}
+
+/* print slowest commands to stderr */
+static void hotspot_end (struct tclln_data *tclln, const char *script_name)
+{
+    GArray *hotspots = tclln->hotspots;
+    tclln->hotspots  = NULL;
+
+    unsigned long time_total = 0;
+    for (guint i = 0; i < hotspots->len; i++) {
+        time_total += g_array_index (hotspots, struct hotspot, i).time;
+    }
+
+    g_array_sort (hotspots, hotspot_compare);
+
+    fprintf (stderr, "hotspots of %s (%u commands, %.3f ms):\n", script_name, hotspots->len, time_total * 1e-6);
+    fprintf (stderr, "  %12s %6s", "time ms", "%");
+    if (tclln->hotspot_memory) {
+        fprintf (stderr, " %12s", "memory KB");
+    }
+    fprintf (stderr, "  %s\n", "lines");
+
+    for (guint i = 0; (i < hotspots->len) && (i < (guint) tclln->hotspot_top_n); i++) {
+        struct hotspot *hotspot = &g_array_index (hotspots, struct hotspot, i);
+
+        fprintf (stderr, "  %12.3f %6.1f", hotspot->time * 1e-6, (time_total > 0 ? hotspot->time * 100.0 / time_total : 0.0));
+        if (tclln->hotspot_memory) {
+            fprintf (stderr, " %12.1f", hotspot->memory / 1024.0);
+        }
+        fprintf (stderr, "  %s:%d", script_name, hotspot->first_line);
+
+        if (hotspot->last_line > hotspot->first_line) {
+            fprintf (stderr, "-%d", hotspot->last_line);
+        }
+        fprintf (stderr, "\n");
+    }
+
+    g_array_free (hotspots, true);
+}
+
+/* command: text from end of previous command - lines are counted from there */
+static void hotspot_record (struct tclln_data *tclln, const char *command, size_t length,
+                struct timespec t_start, long memory_start)
+{
+    struct hotspot hotspot;
+
+    hotspot.time   = time_elapsed_ns (t_start);
+    hotspot.memory = tclln->hotspot_memory ? memory_in_use () - memory_start : 0;
+
+    const char *end = command + length;
+    const char *pos = command;
+    int        line = tclln->hotspot_line;
+
+    /* skip blank lines and comments before the command */
+    while (pos < end) {
+        if (*pos == '\n') {
+            line++;
+        } else if (*pos == '#') {
+            while ((pos < end) && (*pos != '\n')) pos++;
+            continue;
+        } else if (!isspace ((unsigned char) *pos)) {
+            break;
+        }
+        pos++;
+    }
+
+    hotspot.first_line = line;
+
+    bool is_command = (pos < end);
+
+    /* trailing newline ends the last line of the command */
+    const char *last = end;
+    while ((last > pos) && isspace ((unsigned char) last[-1])) last--;
+
+    for (; pos < last; pos++) {
+        if (*pos == '\n') line++;
+    }
+    hotspot.last_line = line;
+
+    for (; pos < end; pos++) {
+        if (*pos == '\n') line++;
+    }
+    tclln->hotspot_line = line;
+
+    /* not for comments at the end of the file */
+    if (is_command) {
+        g_array_append_val (tclln->hotspots, hotspot);
+    }
+}
+
+/* slowest first */
+static gint hotspot_compare (gconstpointer a, gconstpointer b)
+{
+    const struct hotspot *hotspot_a = (const struct hotspot *) a;
+    const struct hotspot *hotspot_b = (const struct hotspot *) b;
+
+    if (hotspot_a->time > hotspot_b->time) return -1;
+    if (hotspot_a->time < hotspot_b->time) return  1;
+
+    return hotspot_a->first_line - hotspot_b->first_line;
+}
+
+/* bytes allocated by malloc - slow with a large heap, and memory Tcl keeps in its own allocator's
+ * caches is not seen */
+static long memory_in_use (void)
+{
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2 ();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+
+/*************************************************
+ * result output
+ *************************************************/
+
+/* Lists and dicts without string representation are written element by element, so
+ * huge results are never converted to a string as a whole. Elements are quoted like
+ * in the string representation of the list. */
+
+void tclln_set_result_limit (struct tclln_data *tclln, size_t max_bytes, size_t max_elements)
+{
+    if (tclln == NULL) return;
+
+    tclln->result_max_bytes    = max_bytes;
+    tclln->result_max_elements = max_elements;
+}
+
+/* print result of interpreter followed by newline - nothing for empty results */
+static void result_print (struct tclln_data *tclln, FILE *out)
+{
+    Tcl_Obj *result = Tcl_GetObjResult (tclln->tcl_interp);
+
+    if (tclln->result_buffer == NULL) {
+        tclln->result_buffer = alloc_malloc (result_buffer_size);
+    }
+
+    struct result_writer writer;
+
+    writer.out       = out;
+    writer.buf       = tclln->result_buffer;
+    writer.len       = 0;
+    writer.arena     = &tclln->eval_arena;
+    writer.bytes     = 0;
+    writer.max_bytes = tclln->result_max_bytes;
+    writer.truncated = false;
+
+    const Tcl_ObjType *list_type = Tcl_GetObjType ("list");
+    const Tcl_ObjType *dict_type = Tcl_GetObjType ("dict");
+
+    size_t max_elements = tclln->result_max_elements;
+    int    n_elements   = 0;
+
+    if ((result->bytes == NULL) && (result->typePtr != NULL) && (result->typePtr == list_type)) {
+        Tcl_Obj **elements;
+        Tcl_ListObjGetElements (NULL, result, &n_elements, &elements);
+
+        for (int i = 0; i < n_elements; i++) {
+            if ((max_elements > 0) && ((size_t) i >= max_elements)) {
+                writer.truncated = true;
+                break;
+            }
+            if (!result_write_element (&writer, elements[i], (i == 0))) break;
+        }
+    } else if ((result->bytes == NULL) && (result->typePtr != NULL) && (result->typePtr == dict_type)) {
+        Tcl_DictSearch search;
+        Tcl_Obj        *key, *value;
+        int            done;
+
+        Tcl_DictObjSize (NULL, result, &n_elements);
+        Tcl_DictObjFirst (NULL, result, &search, &key, &value, &done);
+
+        for (int i = 0; !done; i++) {
+            if ((max_elements > 0) && ((size_t) i >= max_elements)) {
+                writer.truncated = true;
+                break;
+            }
+            if (!result_write_element (&writer, key, (i == 0))) break;
+            if (!result_write_element (&writer, value, false)) break;
+
+            Tcl_DictObjNext (&search, &key, &value, &done);
+        }
+        Tcl_DictObjDone (&search);
+    } else {
+        int length;
+        const char *string = Tcl_GetStringFromObj (result, &length);
+
+        result_write (&writer, string, length);
+    }
+
+    /* quoted elements are written */
+    arena_reset (writer.arena);
+
+    if (writer.bytes == 0) return;
+
+    if (writer.truncated) {
+        char marker [64];
+
+        if (n_elements > 0) {
+            snprintf (marker, sizeof (marker), " ... (%d elements)", n_elements);
+        } else {
+            snprintf (marker, sizeof (marker), " ... (%d bytes)", result->length);
+        }
+
+        writer.max_bytes = 0;
+        result_write (&writer, marker, strlen (marker));
+    }
+
+    writer.max_bytes = 0;
+    result_write (&writer, "\n", 1);
+
+    result_flush (&writer);
+    fflush (out);
+}
+
+/* returns: false if output is truncated */
+static bool result_write_element (struct result_writer *writer, Tcl_Obj *element, bool first)
+{
+    /* string representation created here is dropped again - see below */
+    bool has_string = (element->bytes != NULL);
+
+    int length;
+    const char *string = Tcl_GetStringFromObj (element, &length);
+
+    int flags;
+    size_t quoted_size = Tcl_ScanCountedElement (string, length, &flags) + 1;
+
+    if (!first) {
+        flags |= TCL_DONT_QUOTE_HASH;
+        if (!result_write (writer, " ", 1)) return false;
+    }
+
+    /* quote directly into the output buffer */
+    char *target;
+
+    if (quoted_size <= result_buffer_size) {
+        if (writer->len + quoted_size > result_buffer_size) {
+            result_flush (writer);
+        }
+        target = writer->buf + writer->len;
+    } else {
+        target = arena_alloc (writer->arena, quoted_size);
+        if (target == NULL) return false;
+    }
+
+    int quoted_length = Tcl_ConvertCountedElement (string, length, target, flags);
+
+    bool result = result_write (writer, target, quoted_length);
+
+    /* shared elements keep it: their string is needed again */
+    if (!has_string && (element->typePtr != NULL) && (element->refCount == 1)) {
+        Tcl_InvalidateStringRep (element);
+    }
+
+    return result;
+}
+
+/* returns: false if output is truncated */
+static bool result_write (struct result_writer *writer, const char *data, size_t length)
+{
+    if ((writer->max_bytes > 0) && (writer->bytes + length > writer->max_bytes)) {
+        length            = writer->max_bytes - writer->bytes;
+        writer->truncated = true;
+
+        /* cut before a character, not inside its UTF-8 sequence */
+        while ((length > 0) && (((unsigned char) data[length] & 0xC0) == 0x80)) length--;
+    }
+
+    if (data == writer->buf + writer->len) {
+        /* already in buffer */
+        writer->len += length;
+    } else {
+        if (writer->len + length > result_buffer_size) {
+            result_flush (writer);
+        }
+
+        if (length >= result_buffer_size) {
+            fwrite (data, 1, length, writer->out);
+        } else {
+            memcpy (writer->buf + writer->len, data, length);
+            writer->len += length;
+        }
+    }
+
+    writer->bytes += length;
+
+    return !writer->truncated;
+}
+
+static void result_flush (struct result_writer *writer)
+{
+    if (writer->len > 0) {
+        fwrite (writer->buf, 1, writer->len, writer->out);
+        writer->len = 0;
+    }
+}
+
+
+/*************************************************
+ * interrupt
+ *************************************************/
+
+/* Ctrl-C sends SIGINT while a command runs (the terminal is not in raw mode then).
+ * The signal handler only marks an async handler - the async handler cancels the
+ * evaluation in the interpreter thread. The handler replaces the one of the host
+ * application only in the shell or after tclln_set_interrupt_handler, and only for one
+ * instance at a time. The watchdog thread cancels commands running longer than the
+ * time limit (Tcl_CancelEval can be called from any thread). */
+
+void tclln_set_interrupt_handler (struct tclln_data *tclln, bool enable)
+{
+    if (tclln == NULL) return;
+
+    tclln->interrupt_sigint = enable;
+}
+
+void tclln_set_command_timeout (struct tclln_data *tclln, unsigned long timeout_ms)
+{
+    if (tclln == NULL) return;
+
+    g_mutex_lock (&tclln->watchdog_mutex);
+    tclln->command_timeout_ms = timeout_ms;
+    g_mutex_unlock (&tclln->watchdog_mutex);
+
+    if ((timeout_ms > 0) && (tclln->watchdog == NULL)) {
+        tclln->watchdog = g_thread_new ("tclln-watchdog", watchdog_thread, tclln);
+    }
+}
+
+static void interrupt_begin (struct tclln_data *tclln)
+{
+    if (tclln->interrupt_async == NULL) {
+        tclln->interrupt_async = Tcl_AsyncCreate (interrupt_async_proc, (ClientData) tclln);
+    }
+
+    /* nested evaluation (e.g. tclln_run_buffer from a command): covered by the outer one */
+    if (tclln->evaluating++ > 0) return;
+
+    if (tclln->interrupt_sigint) {
+        g_mutex_lock (&interrupt_mutex);
+
+        /* another instance (e.g. in another thread) keeps Ctrl-C */
+        if (interrupt_owner == NULL) {
+            interrupt_owner         = tclln;
+            interrupt_async_pending = tclln->interrupt_async;
+
+            struct sigaction action;
+            memset (&action, 0, sizeof (action));
+            action.sa_handler = interrupt_signal;
+            action.sa_flags   = SA_RESTART;     /* blocking calls of the host go on */
+            sigemptyset (&action.sa_mask);
+
+            sigaction (SIGINT, &action, &tclln->interrupt_saved_action);
+
+            tclln->interrupt_installed = true;
+        }
+
+        g_mutex_unlock (&interrupt_mutex);
+    }
+
+    interrupt_next (tclln);
+}
+
+/* next top-level command of a file: the time limit starts again
+ * (signal handler stays installed - Ctrl-C between commands cancels the next one) */
+static void interrupt_next (struct tclln_data *tclln)
+{
+    if ((tclln->evaluating != 1) || (tclln->watchdog == NULL)) return;
+
+    g_mutex_lock (&tclln->watchdog_mutex);
+    if (tclln->command_timeout_ms > 0) {
+        tclln->watchdog_deadline = g_get_monotonic_time () + tclln->command_timeout_ms * G_TIME_SPAN_MILLISECOND;
+        g_cond_signal (&tclln->watchdog_cond);
+    }
+    g_mutex_unlock (&tclln->watchdog_mutex);
+}
+
+static void interrupt_end (struct tclln_data *tclln)
+{
+    if (--tclln->evaluating > 0) return;
+
+    if (tclln->interrupt_installed) {
+        g_mutex_lock (&interrupt_mutex);
+
+        sigaction (SIGINT, &tclln->interrupt_saved_action, NULL);
+
+        interrupt_async_pending    = NULL;
+        interrupt_owner            = NULL;
+        tclln->interrupt_installed = false;
+
+        g_mutex_unlock (&interrupt_mutex);
+    }
+
+    if (tclln->watchdog != NULL) {
+        g_mutex_lock (&tclln->watchdog_mutex);
+        tclln->watchdog_deadline = 0;
+        g_mutex_unlock (&tclln->watchdog_mutex);
+    }
+
+    /* cancelled just after the command finished: do not cancel the next one */
+    if (Tcl_AsyncReady ()) {
+        Tcl_AsyncInvoke (tclln->tcl_interp, TCL_OK);
+    }
+
+    interrupt_reset (tclln);
+}
+
+/* reset cancellation of an unwound command */
+static void interrupt_reset (struct tclln_data *tclln)
+{
+    if (Tcl_Canceled (tclln->tcl_interp, 0) == TCL_ERROR) {
+        Tcl_InterpState state = Tcl_SaveInterpState (tclln->tcl_interp, TCL_OK);
+
+        /* fails and resets the cancellation (Tcl_EvalEx and evaluation of a script object do not) */
+        Tcl_Obj *command = Tcl_NewStringObj ("::list", -1);
+        Tcl_IncrRefCount (command);
+        Tcl_EvalObjv (tclln->tcl_interp, 1, &command, 0);
+        Tcl_DecrRefCount (command);
+
+        Tcl_RestoreInterpState (tclln->tcl_interp, state);
+    }
+}
+
+static void interrupt_signal (int signal_number)
+{
+    if (interrupt_async_pending != NULL) {
+        Tcl_AsyncMark (interrupt_async_pending);
+    }
+}
+
+static int interrupt_async_proc (ClientData client_data, Tcl_Interp *interp, int code)
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    if (tclln->evaluating > 0) {
+        Tcl_CancelEval (tclln->tcl_interp, Tcl_NewStringObj ("interrupted", -1), NULL, TCL_CANCEL_UNWIND);
+    }
+
+    return code;
+}
+
+static gpointer watchdog_thread (gpointer data)
+{
+    struct tclln_data *tclln = (struct tclln_data *) data;
+
+    g_mutex_lock (&tclln->watchdog_mutex);
+
+    while (!tclln->watchdog_quit) {
+        if (tclln->watchdog_deadline == 0) {
+            g_cond_wait (&tclln->watchdog_cond, &tclln->watchdog_mutex);
+            continue;
+        }
+
+        if (g_get_monotonic_time () < tclln->watchdog_deadline) {
+            g_cond_wait_until (&tclln->watchdog_cond, &tclln->watchdog_mutex, tclln->watchdog_deadline);
+            continue;
+        }
+
+        char message [64];
+        snprintf (message, sizeof (message), "time limit of %lu ms exceeded", tclln->command_timeout_ms);
+
+        Tcl_CancelEval (tclln->tcl_interp, Tcl_NewStringObj (message, -1), NULL, TCL_CANCEL_UNWIND);
+
+        tclln->watchdog_deadline = 0;
+    }
+
+    g_mutex_unlock (&tclln->watchdog_mutex);
+
+    return NULL;
+}
+
+
+/*************************************************
+ * script cache
+ *************************************************/
+
+void tclln_provide_cached_source (struct tclln_data *tclln)
+{
+    if (tclln == NULL) return;
+
+    /* already provided? */
+    if (tclln->source_proc != NULL) return;
+
+    Tcl_CmdInfo source_info;
+    if (Tcl_GetCommandInfo (tclln->tcl_interp, "::source", &source_info) == 0) return;
+    if (source_info.objProc == NULL) return;
+
+    tclln->source_proc        = source_info.objProc;
+    tclln->source_client_data = source_info.objClientData;
+
+    Tcl_CreateObjCommand (tclln->tcl_interp, "::source", source_command, (ClientData) tclln, NULL);
+    Tcl_CreateObjCommand (tclln->tcl_interp, "tclln::script_cache_stats", script_cache_stats_command, (ClientData) tclln, NULL);
+}
+
+void tclln_script_cache_stats (struct tclln_data *tclln, unsigned long *hits, unsigned long *misses)
+{
+    if (tclln == NULL) return;
+
+    if (hits   != NULL) *hits   = tclln->script_cache_hits;
+    if (misses != NULL) *misses = tclln->script_cache_misses;
+}
+
+/* find cached script for path - (re)load it if necessary
+ *   load: false if the script isn't needed now - a file is then only remembered, and loaded when
+ *         it is looked up again (tclln_run_file evaluates it from a mapping the first time)
+ * returns: NULL if the file is not cacheable, cannot be read or is not loaded */
+static struct script_cache_entry *script_cache_lookup (struct tclln_data *tclln, Tcl_Obj *path, bool load)
+{
+    Tcl_Obj *norm_path = Tcl_FSGetNormalizedPath (tclln->tcl_interp, path);
+    if (norm_path == NULL) return NULL;
+
+    const char *key = Tcl_GetString (norm_path);
+
+    struct stat file_stat;
+    if (stat (key, &file_stat) != 0) return NULL;
+    if (!S_ISREG (file_stat.st_mode)) return NULL;
+
+    struct script_cache_entry *entry = (struct script_cache_entry *) g_hash_table_lookup (tclln->script_cache, key);
+
+    if ((entry != NULL) && script_cache_entry_valid (entry, &file_stat)) {
+        g_queue_unlink (&tclln->script_lru, entry->lru_link);
+        g_queue_push_head_link (&tclln->script_lru, entry->lru_link);
+
+        if (entry->script != NULL) {
+            tclln->script_cache_hits++;
+            return entry;
+        }
+
+        /* used again: worth loading */
+        load = true;
+    }
+
+    tclln->script_cache_misses++;
+
+    if (entry != NULL) {
+        script_cache_remove (tclln, entry);
+    }
+
+    if (file_stat.st_size > script_cache_max_file_size) return NULL;
+
+    /* load script */
+    Tcl_Obj *script = NULL;
+
+    if (load) {
+        script = script_load (key, &file_stat);
+        if (script == NULL) return NULL;
+
+        Tcl_IncrRefCount (script);
+    }
+
+    entry = (struct script_cache_entry *) alloc_malloc (sizeof (struct script_cache_entry));
+
+    entry->path     = g_strdup (key);
+    entry->device   = file_stat.st_dev;
+    entry->inode    = file_stat.st_ino;
+    entry->size     = file_stat.st_size;
+    entry->mtime    = file_stat.st_mtim;
+    entry->script   = script;
+    entry->commands = NULL;
+    entry->bytes    = sizeof (struct script_cache_entry) + strlen (key) + 1 + (load ? file_stat.st_size : 0);
+    entry->lru_link = NULL;
+
+    script_cache_insert (tclln, entry);
+
+    return (load ? entry : NULL);
+}
+
+/* add entry - least recently used entries are dropped beyond script_cache_max_size */
+static void script_cache_insert (struct tclln_data *tclln, struct script_cache_entry *entry)
+{
+    g_hash_table_insert (tclln->script_cache, entry->path, entry);
+    g_queue_push_head (&tclln->script_lru, entry);
+    entry->lru_link = tclln->script_lru.head;
+
+    tclln->script_cache_bytes += entry->bytes;
+
+    script_cache_limit (tclln, entry);
+}
+
+/* drop least recently used entries beyond script_cache_max_size - keep is kept even if it exceeds the limit alone */
+static void script_cache_limit (struct tclln_data *tclln, struct script_cache_entry *keep)
+{
+    while ((tclln->script_cache_bytes > script_cache_max_size) && (g_queue_peek_tail (&tclln->script_lru) != keep)) {
+        script_cache_remove (tclln, (struct script_cache_entry *) g_queue_peek_tail (&tclln->script_lru));
+    }
+}
+
+/* running scripts keep their script and commands referenced */
+static void script_cache_remove (struct tclln_data *tclln, struct script_cache_entry *entry)
+{
+    g_queue_delete_link (&tclln->script_lru, entry->lru_link);
+
+    tclln->script_cache_bytes -= entry->bytes;
+
+    g_hash_table_remove (tclln->script_cache, entry->path);
+}
+
+static void script_cache_free (struct tclln_data *tclln)
+{
+    g_hash_table_remove_all (tclln->script_cache);
+    g_queue_clear (&tclln->script_lru);
+
+    tclln->script_cache_bytes = 0;
+}
+
+/* read script like source does
+ *   file_stat: set to status of the loaded file
+ * returns: script object or NULL if the file cannot be read (errno is set) */
+static Tcl_Obj *script_load (const char *file_name, struct stat *file_stat)
+{
+    int fd = open (file_name, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    if (fstat (fd, file_stat) != 0) {
+        close (fd);
+        return NULL;
+    }
+    if (!S_ISREG (file_stat->st_mode)) {
+        close (fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    Tcl_Obj *script;
+    if (file_stat->st_size == 0) {
+        script = Tcl_NewObj ();
+    } else {
+        void *map = mmap (NULL, file_stat->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            int map_errno = errno;
+            close (fd);
+            errno = map_errno;
+            return NULL;
+        }
+
+        madvise (map, file_stat->st_size, MADV_SEQUENTIAL);
+
+        /* end of file character as in source */
+        const char *eof_char = memchr (map, '\032', file_stat->st_size);
+        size_t      length   = (eof_char == NULL ? (size_t) file_stat->st_size : (size_t) (eof_char - (const char *) map));
+
+        script = Tcl_NewStringObj ((const char *) map, length);
+
+        munmap (map, file_stat->st_size);
+    }
+    close (fd);
+
+    return script;
+}
+
+static bool script_cache_entry_valid (const struct script_cache_entry *entry, const struct stat *file_stat)
+{
+    if (entry->device        != file_stat->st_dev)          return false;
+    if (entry->inode         != file_stat->st_ino)          return false;
+    if (entry->size          != file_stat->st_size)         return false;
+    if (entry->mtime.tv_sec  != file_stat->st_mtim.tv_sec)  return false;
+    if (entry->mtime.tv_nsec != file_stat->st_mtim.tv_nsec) return false;
+
+    return true;
+}
+
+static void script_cache_entry_free (gpointer data)
+{
+    struct script_cache_entry *entry = (struct script_cache_entry *) data;
+
+    if (entry->commands != NULL) {
+        g_ptr_array_unref (entry->commands);
+    }
+    if (entry->script != NULL) {
+        Tcl_DecrRefCount (entry->script);
+    }
+
+    g_free (entry->path);
+    alloc_free (entry);
+}
+
+static void script_cache_obj_free (gpointer data)
+{
+    Tcl_Obj *obj = (Tcl_Obj *) data;
+
+    Tcl_DecrRefCount (obj);
+}
+
+/* top-level commands of cached script - split on first use */
+static GPtrArray *script_cache_commands (struct tclln_data *tclln, struct script_cache_entry *entry)
+{
+    if (entry->commands != NULL) return entry->commands;
+
+    entry->commands = g_ptr_array_new_with_free_func (script_cache_obj_free);
+
+    int length;
+    const char *script     = Tcl_GetStringFromObj (entry->script, &length);
+    const char *script_end = script + length;
+
+    struct command_scanner scanner;
+    command_scanner_init (&scanner);
+
+    for (const char *cmd_start = script; cmd_start < script_end; ) {
+        const char *cmd_end = script_next_command (&scanner, cmd_start, script_end);
+
+        Tcl_Obj *command = Tcl_NewStringObj (cmd_start, cmd_end - cmd_start);
+        Tcl_IncrRefCount (command);
+        g_ptr_array_add (entry->commands, command);
+
+        cmd_start = cmd_end;
+    }
+
+    command_scanner_free (&scanner);
+
+    /* copies of the commands */
+    size_t bytes = entry->commands->len * (sizeof (gpointer) + sizeof (Tcl_Obj)) + length;
+
+    entry->bytes              += bytes;
+    tclln->script_cache_bytes += bytes;
+
+    script_cache_limit (tclln, entry);
+
+    return entry->commands;
+}
+
+/* set [info script]
+ * returns: previous value with incremented reference count, NULL if it cannot be read (unwound by exit) */
+static Tcl_Obj *script_cache_set_info_script (Tcl_Interp *interp, Tcl_Obj *script_name)
+{
+    Tcl_Obj *command = Tcl_NewListObj (0, NULL);
+    Tcl_IncrRefCount (command);
+
+    Tcl_ListObjAppendElement (NULL, command, Tcl_NewStringObj ("::info", -1));
+    Tcl_ListObjAppendElement (NULL, command, Tcl_NewStringObj ("script", -1));
+
+    Tcl_Obj *old_name = NULL;
+    if (Tcl_EvalObjEx (interp, command, TCL_EVAL_DIRECT) == TCL_OK) {
+        old_name = Tcl_GetObjResult (interp);
+        Tcl_IncrRefCount (old_name);
+    }
+
+    Tcl_ListObjAppendElement (NULL, command, script_name);
+    Tcl_EvalObjEx (interp, command, TCL_EVAL_DIRECT);
+
+    Tcl_DecrRefCount (command);
+    Tcl_ResetResult (interp);
+
+    return old_name;
+}
+
+/* evaluate loaded script like source does */
+static int script_cache_source (struct tclln_data *tclln, Tcl_Obj *script, Tcl_Obj *path)
+{
+    Tcl_Interp *interp = tclln->tcl_interp;
+
+    /* keep script even if the cache entry is replaced while running */
+    Tcl_IncrRefCount (script);
+
+    Tcl_Obj *old_name = script_cache_set_info_script (interp, path);
+
+    int tcl_res = Tcl_EvalObjEx (interp, script, 0);
+
+    if (tcl_res == TCL_RETURN) {
+        /* return in script: returns from source */
+        Tcl_Obj *options   = Tcl_GetReturnOptions (interp, tcl_res);
+        Tcl_Obj *level_key = Tcl_NewStringObj ("-level", -1);
+        Tcl_Obj *level_obj = NULL;
+        int      level     = 1;
+
+        Tcl_IncrRefCount (options);
+        Tcl_IncrRefCount (level_key);
+
+        if ((Tcl_DictObjGet (NULL, options, level_key, &level_obj) == TCL_OK) && (level_obj != NULL)) {
+            Tcl_GetIntFromObj (NULL, level_obj, &level);
+        }
+        Tcl_DictObjPut (NULL, options, level_key, Tcl_NewIntObj (level - 1));
+
+        tcl_res = Tcl_SetReturnOptions (interp, options);
+
+        Tcl_DecrRefCount (level_key);
+        Tcl_DecrRefCount (options);
+    } else if (tcl_res == TCL_ERROR) {
+        Tcl_AppendObjToErrorInfo (interp, Tcl_ObjPrintf ("\n    (file \"%.150s\" line %d)",
+                    Tcl_GetString (path), Tcl_GetErrorLine (interp)));
+    }
+
+    /* restore [info script] without touching the result */
+    Tcl_InterpState state = Tcl_SaveInterpState (interp, tcl_res);
+
+    if (old_name != NULL) {
+        Tcl_Obj *name = script_cache_set_info_script (interp, old_name);
+        if (name != NULL) {
+            Tcl_DecrRefCount (name);
+        }
+        Tcl_DecrRefCount (old_name);
+    }
+
+    tcl_res = Tcl_RestoreInterpState (interp, state);
+
+    Tcl_DecrRefCount (script);
+
+    return tcl_res;
+}
+
+static int source_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    /* source -encoding ...: not cached */
+    if (objc != 2) {
+        return tclln->source_proc (tclln->source_client_data, interp, objc, objv);
+    }
+
+    struct script_cache_entry *entry = script_cache_lookup (tclln, objv[1], true);
+
+    /* not cacheable: let original source report errors */
+    if (entry == NULL) {
+        return tclln->source_proc (tclln->source_client_data, interp, objc, objv);
+    }
+
+    return script_cache_source (tclln, entry->script, objv[1]);
+}
+
+static int script_cache_stats_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    if (objc != 1) {
+        Tcl_WrongNumArgs (interp, 1, objv, NULL);
+        return TCL_ERROR;
+    }
+
+    Tcl_Obj *result = Tcl_NewDictObj ();
+
+    Tcl_DictObjPut (NULL, result, Tcl_NewStringObj ("hits",    -1), Tcl_NewWideIntObj (tclln->script_cache_hits));
+    Tcl_DictObjPut (NULL, result, Tcl_NewStringObj ("misses",  -1), Tcl_NewWideIntObj (tclln->script_cache_misses));
+    Tcl_DictObjPut (NULL, result, Tcl_NewStringObj ("entries", -1), Tcl_NewIntObj (g_hash_table_size (tclln->script_cache)));
+
+    Tcl_SetObjResult (interp, result);
+
+    return TCL_OK;
+}
+
+/*************************************************
+ * parallel execution
+ *************************************************/
+
+/* Every worker thread owns a TclLN of its own (tcl interpreters are bound to the
+ * thread that created them) and runs its scripts one after the other in it, like
+ * tclln_run_file does in one interpreter. With tclln_set_parallel_isolation each script
+ * gets a fresh TclLN instead - created with lazy init, so only scripts using the init
+ * library pay for it. stdout and stderr channels of the worker thread are replaced by a
+ * channel collecting the output of the current script, so the output of every script can
+ * be printed in submission order. Output written by C code through stdio bypasses the
+ * channels and is not collected. */
+
+void tclln_set_parallel_isolation (struct tclln_data *tclln, bool isolated)
+{
+    if (tclln == NULL) return;
+
+    tclln->parallel_isolated = isolated;
+}
+
+bool tclln_run_files_parallel (struct tclln_data *tclln, const char * const script_names[], int n_scripts, int n_threads, int status[])
+{
+    if (tclln == NULL) return false;
+
+    if (n_scripts <= 0) return true;
+
+    if (script_names == NULL) {
+        fprintf (stderr, "Error: no filenames specified\n");
+        return false;
+    }
+
+    if (n_threads <= 0)        n_threads = g_get_num_processors ();
+    if (n_threads > n_scripts) n_threads = n_scripts;
+
+    struct parallel_batch batch;
+
+    batch.tclln        = tclln;
+    batch.script_names = script_names;
+    batch.n_scripts    = n_scripts;
+    batch.next_script  = 0;
+    batch.results      = g_new0 (struct parallel_result, n_scripts);
+
+    g_mutex_init (&batch.mutex);
+    g_cond_init (&batch.cond);
+
+    GThread **threads = g_new (GThread *, n_threads);
+    for (int i = 0; i < n_threads; i++) {
+        threads[i] = g_thread_new ("tclln-worker", parallel_worker, &batch);
+    }
+
+    /* print output in submission order as soon as it is available */
+    bool result = true;
+
+    for (int i = 0; i < n_scripts; i++) {
+        struct parallel_result *script_result = &batch.results[i];
+
+        g_mutex_lock (&batch.mutex);
+        while (!script_result->done) {
+            g_cond_wait (&batch.cond, &batch.mutex);
+        }
+        g_mutex_unlock (&batch.mutex);
+
+        fwrite (script_result->output, 1, script_result->output_len, stdout);
+        g_free (script_result->output);
+
+        if (status != NULL) {
+            status[i] = script_result->status;
+        }
+        if (script_result->status != 0) {
+            result = false;
+        }
+    }
+    fflush (stdout);
+
+    for (int i = 0; i < n_threads; i++) {
+        g_thread_join (threads[i]);
+    }
+    g_free (threads);
+
+    g_cond_clear (&batch.cond);
+    g_mutex_clear (&batch.mutex);
+    g_free (batch.results);
+
+    return result;
+}
+
+static gpointer parallel_worker (gpointer data)
+{
+    struct parallel_batch *batch = (struct parallel_batch *) data;
+
+    /* capture output of this thread */
+    GString *output = g_string_new (NULL);
+
+    char channel_name [32];
+    snprintf (channel_name, sizeof (channel_name), "tclln_output%p", (void *) &output);
+
+    /* channel refers to the variable: output can be replaced after each script */
+    Tcl_Channel channel = Tcl_CreateChannel (&output_channel_type, channel_name, (ClientData) &output, TCL_WRITABLE);
+    Tcl_SetChannelOption (NULL, channel, "-translation", "lf");
+
+    /* keep channel open when the interpreters of the scripts are deleted */
+    Tcl_RegisterChannel (NULL, channel);
+
+    Tcl_SetStdChannel (channel, TCL_STDOUT);
+    Tcl_SetStdChannel (channel, TCL_STDERR);
+
+    bool isolated = batch->tclln->parallel_isolated;
+
+    /* interpreter with the same commands - for all scripts of the thread unless isolated */
+    struct tclln_data *worker = isolated ? NULL : tclln_new_like (batch->tclln, batch->tclln->options);
+
+    while (true) {
+        int i = g_atomic_int_add (&batch->next_script, 1);
+        if (i >= batch->n_scripts) break;
+
+        int script_status = 1;
+
+        if (isolated) {
+            worker = tclln_new_like (batch->tclln, batch->tclln->options | TCLLN_LAZY_INIT);
+        }
+
+        if (worker != NULL) {
+            script_status = parallel_worker_run (worker, batch->script_names[i]);
+        }
+
+        Tcl_Flush (channel);
+
+        if (isolated) {
+            tclln_free (worker);
+            worker = NULL;
+        }
+
+        struct parallel_result *script_result = &batch->results[i];
+
+        g_mutex_lock (&batch->mutex);
+
+        script_result->status     = script_status;
+        script_result->output_len = output->len;
+        script_result->output     = g_string_free (output, false);
+        script_result->done       = true;
+
+        g_cond_broadcast (&batch->cond);
+        g_mutex_unlock (&batch->mutex);
+
+        output = g_string_new (NULL);
+    }
+
+    tclln_free (worker);
+
+    /* closes std channels of this thread */
+    Tcl_FinalizeThread ();
+
+    g_string_free (output, true);
+
+    return NULL;
+}
+
+/* returns: status of script - 0 on success, 1 on error, or code given to exit */
+static int parallel_worker_run (struct tclln_data *worker, const char *script_name)
+{
+    worker->exit_tcl    = false;
+    worker->return_code = 0;
+
+    Tcl_Obj *path = Tcl_NewStringObj (script_name, -1);
+    Tcl_IncrRefCount (path);
+
+    worker->exit_unwind = true;
+
+    int tcl_res = parallel_worker_eval (worker, path);
+
+    Tcl_DecrRefCount (path);
+
+    if (worker->exit_tcl) {
+        Tcl_ResetResult (worker->tcl_interp);
+        return worker->return_code;
+    }
+
+    if (tcl_res != TCL_OK) {
+        /* report like run_print_result */
+        Tcl_Channel channel = Tcl_GetStdChannel (TCL_STDOUT);
+        Tcl_Obj    *message = Tcl_GetObjResult (worker->tcl_interp);
+
+        if ((channel != NULL) && (Tcl_GetCharLength (message) > 0)) {
+            Tcl_WriteObj (channel, message);
+            Tcl_WriteChars (channel, "\n", 1);
+        }
+
+        Tcl_ResetResult (worker->tcl_interp);
+        return 1;
+    }
+
+    Tcl_ResetResult (worker->tcl_interp);
+    return 0;
+}
+
+/* evaluate file command by command like tclln_run_file, with [info script] set like by source
+ * returns: result of the command that stopped evaluation - TCL_OK at the end or on return */
+static int parallel_worker_eval (struct tclln_data *worker, Tcl_Obj *path)
+{
+    Tcl_Interp *interp = worker->tcl_interp;
+
+    struct stat file_stat;
+    Tcl_Obj     *script = script_load (Tcl_GetString (path), &file_stat);
+
+    if (script == NULL) {
+        Tcl_SetObjResult (interp, Tcl_ObjPrintf ("couldn't read file \"%s\": %s", Tcl_GetString (path), Tcl_PosixError (interp)));
+        return TCL_ERROR;
+    }
+
+    Tcl_IncrRefCount (script);
+
+    Tcl_Obj *old_name = script_cache_set_info_script (interp, path);
+
+    int        length;
+    const char *cmd_start  = Tcl_GetStringFromObj (script, &length);
+    const char *script_end = cmd_start + length;
+    int        tcl_res     = TCL_OK;
+
+    struct command_scanner scanner;
+    command_scanner_init (&scanner);
+
+    while ((cmd_start < script_end) && !worker->exit_tcl) {
+        const char *cmd_end = script_next_command (&scanner, cmd_start, script_end);
+
+        tcl_res = Tcl_EvalEx (interp, cmd_start, cmd_end - cmd_start, 0);
+
+        if (tcl_res != TCL_OK) break;
+
+        cmd_start = cmd_end;
+    }
+
+    command_scanner_free (&scanner);
+
+    /* return ends the script like source */
+    if (tcl_res == TCL_RETURN) {
+        tcl_res = TCL_OK;
+    }
+
+    /* restore [info script] without touching the result */
+    Tcl_InterpState state = Tcl_SaveInterpState (interp, tcl_res);
+
+    if (old_name != NULL) {
+        Tcl_Obj *name = script_cache_set_info_script (interp, old_name);
+        if (name != NULL) {
+            Tcl_DecrRefCount (name);
+        }
+        Tcl_DecrRefCount (old_name);
+    }
+
+    tcl_res = Tcl_RestoreInterpState (interp, state);
+
+    Tcl_DecrRefCount (script);
+
+    return tcl_res;
+}
+
+static int output_channel_close (ClientData instance_data, Tcl_Interp *interp)
+{
+    return 0;
+}
+
+static int output_channel_input (ClientData instance_data, char *buf, int to_read, int *error_code)
+{
+    *error_code = EINVAL;
+    return -1;
+}
+
+static int output_channel_output (ClientData instance_data, const char *buf, int to_write, int *error_code)
+{
+    GString *buffer = *((GString **) instance_data);
+
+    g_string_append_len (buffer, buf, to_write);
+
+    return to_write;
+}
+
+static void output_channel_watch (ClientData instance_data, int mask)
+{
+}
+
+static int output_channel_get_handle (ClientData instance_data, int direction, ClientData *handle)
+{
+    return TCL_ERROR;
+}
+
+/*************************************************
+ * command scanner
+ *************************************************/
+
+/* The scanner follows the rules of the tcl parser as far as they matter for the
+ * completeness of a command: braced and quoted words, command substitution, array
+ * indices, braced variable names, backslashes and comments.
+ * The state is kept between calls, so every input character is looked at only once. */
+
+enum scanner_context {
+    SCANNER_BRACKET,            /* [...]   */
+    SCANNER_QUOTE,              /* "..."   */
+    SCANNER_INDEX               /* $a(...) */
+};
+
+enum scanner_var_state {
+    SCANNER_VAR_NONE = 0,
+    SCANNER_VAR_START,          /* after '$' */
+    SCANNER_VAR_NAME,           /* inside name */
+    SCANNER_VAR_COLON,          /* after single ':' in name */
+    SCANNER_VAR_COLONS,         /* after "::" in name */
+    SCANNER_VAR_BRACED          /* inside ${...} */
+};
+
+enum scanner_expand_state {
+    SCANNER_EXPAND_NONE = 0,
+    SCANNER_EXPAND_OPEN,        /* after opening brace of word */
+    SCANNER_EXPAND_STAR         /* after "{*" */
+};
+
+enum scanner_close_state {
+    SCANNER_CLOSE_NONE = 0,
+    SCANNER_CLOSE_WORD,         /* after "..." or {...} */
+    SCANNER_CLOSE_BACKSLASH     /* after "..."\ or {...}\ */
+};
+
+static void command_scanner_init (struct command_scanner *scanner)
+{
+    scanner->contexts = g_byte_array_new ();
+    command_scanner_reset (scanner);
+}
+
+static void command_scanner_free (struct command_scanner *scanner)
+{
+    if (scanner->contexts != NULL) {
+        g_byte_array_free (scanner->contexts, true);
+        scanner->contexts = NULL;
+    }
+}
+
+static void command_scanner_reset (struct command_scanner *scanner)
+{
+    g_byte_array_set_size (scanner->contexts, 0);
+
+    scanner->brace_depth   = 0;
+    scanner->var_state     = SCANNER_VAR_NONE;
+    scanner->close_state   = SCANNER_CLOSE_NONE;
+    scanner->expand_state  = SCANNER_EXPAND_NONE;
+    scanner->backslash     = false;
+    scanner->continuation  = false;
+    scanner->comment       = false;
+    scanner->command_start = true;
+    scanner->word_start    = true;
+    scanner->error         = false;
+}
+
+static bool command_scanner_complete (const struct command_scanner *scanner)
+{
+    if (scanner->error) return true;
+
+    /* "...}\" or "..."\ at end: tcl reports extra characters */
+    if (scanner->close_state == SCANNER_CLOSE_BACKSLASH) return true;
+
+    if (scanner->continuation)      return false;
+    if (scanner->contexts->len > 0) return false;
+    if (scanner->brace_depth   > 0) return false;
+    if (scanner->var_state == SCANNER_VAR_BRACED) return false;
+
+    return true;
+}
+
+static inline bool scanner_is_space (char c)
+{
+    return ((c == ' ') || (c == '\t') || (c == '\v') || (c == '\f') || (c == '\r'));
+}
+
+static inline bool scanner_is_varchar (char c)
+{
+    return (isalnum ((unsigned char) c) || (c == '_'));
+}
+
+static inline int scanner_context (const struct command_scanner *scanner)
+{
+    if (scanner->contexts->len == 0) return SCANNER_BRACKET;
+
+    return scanner->contexts->data[scanner->contexts->len - 1];
+}
+
+static inline void scanner_push (struct command_scanner *scanner, guint8 context)
+{
+    g_byte_array_append (scanner->contexts, &context, 1);
+}
+
+static inline void scanner_pop (struct command_scanner *scanner)
+{
+    g_byte_array_set_size (scanner->contexts, scanner->contexts->len - 1);
+}
+
+static void command_scanner_feed (struct command_scanner *scanner, const char *input, size_t length)
+{
+    const char *end = input + length;
+
+    for (const char *pos = input; pos < end; pos++) {
+        char c = *pos;
+
+        /* after a syntax error the rest does not matter */
+        if (scanner->error) return;
+
+        scanner->continuation = false;
+
+        /* escaped character */
+        if (scanner->backslash) {
+            scanner->backslash = false;
+
+            if (c != '\n') {
+                if (!scanner->comment) {
+                    scanner->command_start = false;
+                    scanner->word_start    = false;
+                }
+                continue;
+            }
+
+            /* backslash-newline continues comments and separates words in scripts */
+            if (scanner->comment) {
+                scanner->continuation = true;
+            } else if ((scanner->brace_depth == 0) && (scanner_context (scanner) == SCANNER_BRACKET)) {
+                scanner->continuation = true;
+                scanner->word_start   = true;
+            }
+            continue;
+        }
+
+        /* comment: up to end of line */
+        if (scanner->comment) {
+            if (c == '\\') {
+                scanner->backslash = true;
+            } else if (c == '\n') {
+                scanner->comment       = false;
+                scanner->command_start = true;
+                scanner->word_start    = true;
+            }
+            continue;
+        }
+
+        /* braced word: only braces and backslashes matter */
+        if (scanner->brace_depth > 0) {
+            int expand_state = scanner->expand_state;
+            scanner->expand_state = SCANNER_EXPAND_NONE;
+
+            if (c == '\\') {
+                scanner->backslash = true;
+            } else if (c == '{') {
+                scanner->brace_depth++;
+            } else if (c == '}') {
+                scanner->brace_depth--;
+                if (scanner->brace_depth == 0) {
+                    if (expand_state == SCANNER_EXPAND_STAR) {
+                        /* {*}: the expanded word follows directly */
+                        scanner->word_start = true;
+                    } else {
+                        scanner->close_state = SCANNER_CLOSE_WORD;
+                    }
+                }
+            } else if ((c == '*') && (expand_state == SCANNER_EXPAND_OPEN)) {
+                scanner->expand_state = SCANNER_EXPAND_STAR;
+            }
+            continue;
+        }
+
+        /* braced variable name: up to the next closing brace */
+        if (scanner->var_state == SCANNER_VAR_BRACED) {
+            if (c == '}') scanner->var_state = SCANNER_VAR_NONE;
+            continue;
+        }
+
+        /* after closing quote/brace the word has to end */
+        if (scanner->close_state == SCANNER_CLOSE_BACKSLASH) {
+            scanner->close_state = SCANNER_CLOSE_NONE;
+            if (c != '\n') {
+                scanner->error = true;
+                return;
+            }
+            scanner->continuation = true;
+            scanner->word_start   = true;
+            continue;
+        }
+        if (scanner->close_state == SCANNER_CLOSE_WORD) {
+            scanner->close_state = SCANNER_CLOSE_NONE;
+            if (c == '\\') {
+                scanner->close_state = SCANNER_CLOSE_BACKSLASH;
+                continue;
+            }
+
+            bool bracket = (scanner->contexts->len > 0);
+            if ((!scanner_is_space (c)) && (c != '\n') && (c != ';') && (!((c == ']') && bracket))) {
+                scanner->error = true;
+                return;
+            }
+        }
+
+        /* variable name */
+        if (scanner->var_state != SCANNER_VAR_NONE) {
+            int var_state = scanner->var_state;
+            scanner->var_state = SCANNER_VAR_NONE;
+
+            if ((var_state == SCANNER_VAR_START) && (c == '{')) {
+                scanner->var_state = SCANNER_VAR_BRACED;
+                continue;
+            }
+            if (var_state == SCANNER_VAR_COLON) {
+                if (c == ':') {
+                    scanner->var_state = SCANNER_VAR_COLONS;
+                    continue;
+                }
+                /* single ':' ended variable name - handle character normally */
+            } else {
+                if (scanner_is_varchar (c)) {
+                    scanner->var_state = SCANNER_VAR_NAME;
+                    continue;
+                }
+                if (c == ':') {
+                    scanner->var_state = (var_state == SCANNER_VAR_COLONS ? SCANNER_VAR_COLONS : SCANNER_VAR_COLON);
+                    continue;
+                }
+                if (c == '(') {
+                    scanner_push (scanner, SCANNER_INDEX);
+                    continue;
+                }
+                /* end of variable name - handle character normally */
+            }
+        }
+
+        /* substitutions: everywhere except in braces */
+        if (c == '\\') {
+            scanner->backslash = true;
+            continue;
+        }
+        if (c == '[') {
+            scanner_push (scanner, SCANNER_BRACKET);
+            scanner->command_start = true;
+            scanner->word_start    = true;
+            continue;
+        }
+        if (c == '$') {
+            scanner->var_state     = SCANNER_VAR_START;
+            scanner->command_start = false;
+            scanner->word_start    = false;
+            continue;
+        }
+
+        int context = scanner_context (scanner);
+
+        /* quoted word */
+        if (context == SCANNER_QUOTE) {
+            if (c == '"') {
+                scanner_pop (scanner);
+                scanner->close_state = SCANNER_CLOSE_WORD;
+            }
+            continue;
+        }
+
+        /* array index */
+        if (context == SCANNER_INDEX) {
+            if (c == ')') scanner_pop (scanner);
+            continue;
+        }
+
+        /* script: top level or command substitution */
+        if ((c == '\n') || (c == ';')) {
+            scanner->command_start = true;
+            scanner->word_start    = true;
+        } else if (scanner_is_space (c)) {
+            scanner->word_start    = true;
+        } else if ((c == '#') && scanner->command_start) {
+            scanner->comment       = true;
+        } else if ((c == '{') && scanner->word_start) {
+            scanner->brace_depth   = 1;
+            scanner->expand_state  = SCANNER_EXPAND_OPEN;
+            scanner->command_start = false;
+            scanner->word_start    = false;
+        } else if ((c == '"') && scanner->word_start) {
+            scanner_push (scanner, SCANNER_QUOTE);
+            scanner->command_start = false;
+            scanner->word_start    = false;
+        } else if ((c == ']') && (scanner->contexts->len > 0)) {
+            scanner_pop (scanner);
+            scanner->command_start = false;
+            scanner->word_start    = false;
+        } else {
+            scanner->command_start = false;
+            scanner->word_start    = false;
+        }
+    }
+}
+
+/*************************************************
+ * custom commands
+ *************************************************/
+
+Tcl_Command tclln_add_command (
+                struct tclln_data *tclln, const char *command_name, const char * const arg_complete_list[],
+                Tcl_ObjCmdProc *command_proc, ClientData client_data, Tcl_CmdDeleteProc *delete_proc)
+{
+    /* for interpreters of tclln_run_files_parallel and pools */
+    struct command_registration *command = (struct command_registration *) alloc_malloc (sizeof (struct command_registration));
+
+    memset (command, 0, sizeof (struct command_registration));
+
+    command->name              = g_strdup (command_name);
+    command->arg_complete_list = g_strdupv ((char **) arg_complete_list);
+    command->proc              = command_proc;
+    command->client_data       = client_data;
+    command->delete_proc       = delete_proc;
+    command->time_min          = G_MAXULONG;
+
+    g_ptr_array_add (tclln->commands, command);
+
+    Tcl_Command result;
+
+    if (tclln->options & TCLLN_PROFILE_COMMANDS) {
+        result = Tcl_CreateObjCommand (tclln->tcl_interp, command_name, profile_command_proc, (ClientData) command, profile_command_delete);
+    } else {
+        result = Tcl_CreateObjCommand (tclln->tcl_interp, command_name, command_proc, client_data, delete_proc);
+    }
+
+    if (arg_complete_list != NULL) {
+        completion_table_add_command (tclln, command_name, arg_complete_list);
+    }
+
+    return result;
+}
+
+static void command_registration_free (gpointer data)
+{
+    struct command_registration *command = (struct command_registration *) data;
+
+    g_free (command->name);
+    g_strfreev (command->arg_complete_list);
+    alloc_free (command);
+}
+
+/* returns: latest registration of command_name or NULL */
+static struct command_registration *command_registration_find (struct tclln_data *tclln, const char *command_name)
+{
+    for (guint i = tclln->commands->len; i > 0; i--) {
+        struct command_registration *command = (struct command_registration *) g_ptr_array_index (tclln->commands, i - 1);
+
+        if (strcmp (command->name, command_name) == 0) {
+            return command;
+        }
+    }
+
+    return NULL;
+}
+
+/*************************************************
+ * command profiler
+ *************************************************/
+
+/* With TCLLN_PROFILE_COMMANDS, commands added by tclln_add_command call
+ * profile_command_proc with their registration as client data. Without the option
+ * the command procs are called directly. */
+
+bool tclln_command_stats (struct tclln_data *tclln, const char *command_name, unsigned long *calls,
+                unsigned long *total_ns, unsigned long *min_ns, unsigned long *max_ns,
+                unsigned long histogram[TCLLN_COMMAND_HISTOGRAM_SIZE])
+{
+    if ((tclln == NULL) || (command_name == NULL)) return false;
+    if (!(tclln->options & TCLLN_PROFILE_COMMANDS)) return false;
+
+    struct command_registration *command = command_registration_find (tclln, command_name);
+    if (command == NULL) return false;
+
+    if (calls    != NULL) *calls    = command->calls;
+    if (total_ns != NULL) *total_ns = command->time_total;
+    if (min_ns   != NULL) *min_ns   = (command->calls > 0 ? command->time_min : 0);
+    if (max_ns   != NULL) *max_ns   = command->time_max;
+
+    if (histogram != NULL) {
+        memcpy (histogram, command->histogram, sizeof (command->histogram));
+    }
+
+    return true;
+}
+
+/* time stamp counter on x86: reading it is cheaper than clock_gettime (calibrated once) */
+static void profile_clock_init (void)
+{
+    static GMutex mutex;
+
+    g_mutex_lock (&mutex);
+
+    if (profile_clock_ns_per_tick == 0) {
+#if defined(__x86_64__) || defined(__i386__)
+        struct timespec t_start = time_now ();
+        guint64         c_start = __rdtsc ();
+
+        unsigned long t;
+        while ((t = time_elapsed_ns (t_start)) < 1000000) {}
+
+        guint64 c_end = __rdtsc ();
+
+        profile_clock_ns_per_tick = (c_end > c_start ? (double) t / (c_end - c_start) : 1.0);
+#else
+        profile_clock_ns_per_tick = 1.0;
+#endif
+    }
+
+    g_mutex_unlock (&mutex);
+}
+
+static inline guint64 profile_clock (void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc ();
+#else
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+#endif
+}
+
+static int profile_command_proc (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct command_registration *command = (struct command_registration *) client_data;
+
+    guint64 t_start = profile_clock ();
+
+    int result = command->proc (command->client_data, interp, objc, objv);
+
+    unsigned long t = (profile_clock () - t_start) * profile_clock_ns_per_tick;
+
+    command->calls++;
+    command->time_total += t;
+
+    if (t < command->time_min) command->time_min = t;
+    if (t > command->time_max) command->time_max = t;
+
+    /* bucket i: [2^i, 2^(i+1)) ns - last bucket is open */
+    guint bucket = g_bit_storage (t) - 1;
+    if (bucket >= TCLLN_COMMAND_HISTOGRAM_SIZE) bucket = TCLLN_COMMAND_HISTOGRAM_SIZE - 1;
+
+    command->histogram[bucket]++;
+
+    return result;
+}
+
+static void profile_command_delete (ClientData client_data)
+{
+    struct command_registration *command = (struct command_registration *) client_data;
+
+    if (command->delete_proc != NULL) {
+        command->delete_proc (command->client_data);
+    }
+}
+
+/* dict: calls, total_ns, min_ns, max_ns, histogram (list of counts) */
+static Tcl_Obj *profile_command_stats_obj (const struct command_registration *command)
+{
+    Tcl_Obj *stats = Tcl_NewDictObj ();
+
+    Tcl_DictObjPut (NULL, stats, Tcl_NewStringObj ("calls",    -1), Tcl_NewWideIntObj (command->calls));
+    Tcl_DictObjPut (NULL, stats, Tcl_NewStringObj ("total_ns", -1), Tcl_NewWideIntObj (command->time_total));
+    Tcl_DictObjPut (NULL, stats, Tcl_NewStringObj ("min_ns",   -1), Tcl_NewWideIntObj (command->calls > 0 ? command->time_min : 0));
+    Tcl_DictObjPut (NULL, stats, Tcl_NewStringObj ("max_ns",   -1), Tcl_NewWideIntObj (command->time_max));
+
+    Tcl_Obj *histogram = Tcl_NewListObj (0, NULL);
+    for (int i = 0; i < TCLLN_COMMAND_HISTOGRAM_SIZE; i++) {
+        Tcl_ListObjAppendElement (NULL, histogram, Tcl_NewWideIntObj (command->histogram[i]));
+    }
+    Tcl_DictObjPut (NULL, stats, Tcl_NewStringObj ("histogram", -1), histogram);
+
+    return stats;
+}
+
+/* tclln::command_stats ?command? - dict of all commands or stats of one command */
+static int profile_command_stats_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    if (objc > 2) {
+        Tcl_WrongNumArgs (interp, 1, objv, "?command?");
+        return TCL_ERROR;
+    }
+
+    if (objc == 2) {
+        struct command_registration *command = command_registration_find (tclln, Tcl_GetString (objv[1]));
+
+        if (command == NULL) {
+            Tcl_SetObjResult (interp, Tcl_ObjPrintf ("no command \"%s\" added by tclln", Tcl_GetString (objv[1])));
+            return TCL_ERROR;
+        }
+
+        Tcl_SetObjResult (interp, profile_command_stats_obj (command));
+        return TCL_OK;
+    }
+
+    /* latest registration of each name */
+    Tcl_Obj *result = Tcl_NewDictObj ();
+
+    for (guint i = 0; i < tclln->commands->len; i++) {
+        struct command_registration *command = (struct command_registration *) g_ptr_array_index (tclln->commands, i);
+
+        Tcl_DictObjPut (NULL, result, Tcl_NewStringObj (command->name, -1), profile_command_stats_obj (command));
+    }
+
+    Tcl_SetObjResult (interp, result);
+
+    return TCL_OK;
+}
+
+/*************************************************
+ * sampling profiler
+ *************************************************/
+
+/* A thread requests samples periodically by marking an async handler. The async
+ * handler runs in the interpreter thread between commands and records the command
+ * running on each level of "info frame" as folded stack. Samples requested while a
+ * C command runs are taken when it returns and counted with their number. The
+ * interval is stretched if sampling takes more than profile_max_overhead percent. */
+
+bool tclln_profile_start (struct tclln_data *tclln, unsigned long interval_us)
+{
+    if (tclln == NULL) return false;
+
+    if (tclln->profile_thread != NULL) return false;
+
+    if (interval_us == 0)                      interval_us = profile_default_interval_us;
+    if (interval_us < profile_min_interval_us) interval_us = profile_min_interval_us;
+
+    if (tclln->profile_async == NULL) {
+        tclln->profile_async = Tcl_AsyncCreate (profile_sample_async_proc, (ClientData) tclln);
+    }
+
+    /* new profile */
+    if (tclln->profile_stacks == NULL) {
+        tclln->profile_stacks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+        tclln->profile_stack  = g_string_new (NULL);
+    } else {
+        g_hash_table_remove_all (tclln->profile_stacks);
+    }
+
+    tclln->profile_interval_us = interval_us;
+    tclln->profile_quit        = false;
+    g_atomic_int_set (&tclln->profile_ticks, 0);
+    g_atomic_int_set (&tclln->profile_cost_us, 0);
+
+    tclln->profile_thread = g_thread_new ("tclln-profile", profile_sample_thread, tclln);
+
+    return true;
+}
+
+void tclln_profile_stop (struct tclln_data *tclln)
+{
+    if ((tclln == NULL) || (tclln->profile_thread == NULL)) return;
+
+    g_mutex_lock (&tclln->profile_mutex);
+    tclln->profile_quit = true;
+    g_cond_signal (&tclln->profile_cond);
+    g_mutex_unlock (&tclln->profile_mutex);
+
+    g_thread_join (tclln->profile_thread);
+    tclln->profile_thread = NULL;
+
+    g_atomic_int_set (&tclln->profile_ticks, 0);
+}
+
+bool tclln_profile_write (struct tclln_data *tclln, const char *file_name)
+{
+    if ((tclln == NULL) || (file_name == NULL)) return false;
+
+    FILE *file = fopen (file_name, "w");
+    if (file == NULL) {
+        fprintf (stderr, "Error: could not open profile output %s: %s\n", file_name, strerror (errno));
+        return false;
+    }
+
+    if (tclln->profile_stacks != NULL) {
+        GHashTableIter iter;
+        gpointer       stack, samples;
+
+        g_hash_table_iter_init (&iter, tclln->profile_stacks);
+        while (g_hash_table_iter_next (&iter, &stack, &samples)) {
+            fprintf (file, "%s %lu\n", (const char *) stack, (unsigned long) *((guint64 *) samples));
+        }
+    }
+
+    return (fclose (file) == 0);
+}
+
+static gpointer profile_sample_thread (gpointer data)
+{
+    struct tclln_data *tclln = (struct tclln_data *) data;
+
+    g_mutex_lock (&tclln->profile_mutex);
+
+    while (!tclln->profile_quit) {
+        /* bounded overhead: interval >= cost of a sample * 100 / profile_max_overhead */
+        gint64 interval = tclln->profile_interval_us;
+        gint64 min_interval = (gint64) g_atomic_int_get (&tclln->profile_cost_us) * 100 / profile_max_overhead;
+
+        if (interval < min_interval) interval = min_interval;
+
+        gint64 deadline = g_get_monotonic_time () + interval;
+
+        while (!tclln->profile_quit && g_cond_wait_until (&tclln->profile_cond, &tclln->profile_mutex, deadline)) {}
+
+        if (tclln->profile_quit) break;
+
+        g_atomic_int_inc (&tclln->profile_ticks);
+        Tcl_AsyncMark (tclln->profile_async);
+    }
+
+    g_mutex_unlock (&tclln->profile_mutex);
+
+    return NULL;
+}
+
+static int profile_sample_async_proc (ClientData client_data, Tcl_Interp *interp, int code)
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    int ticks = g_atomic_int_get (&tclln->profile_ticks);
+    if (ticks <= 0) return code;
+
+    g_atomic_int_add (&tclln->profile_ticks, -ticks);
+
+    struct timespec t_start = time_now ();
+
+    Tcl_InterpState state = Tcl_SaveInterpState (tclln->tcl_interp, code);
+
+    profile_sample (tclln, ticks);
+
+    code = Tcl_RestoreInterpState (tclln->tcl_interp, state);
+
+    g_atomic_int_set (&tclln->profile_cost_us, (gint) (time_elapsed_ns (t_start) / 1000));
+
+    return code;
+}
+
+/* folded stack: first word of the command of each frame, separated by ';' */
+static void profile_sample (struct tclln_data *tclln, int weight)
+{
+    Tcl_Interp *interp = tclln->tcl_interp;
+
+    Tcl_Obj *objv [3];
+    objv[0] = Tcl_NewStringObj ("info",  -1);
+    objv[1] = Tcl_NewStringObj ("frame", -1);
+    objv[2] = NULL;
+
+    Tcl_Obj *cmd_key = Tcl_NewStringObj ("cmd", -1);
+
+    Tcl_IncrRefCount (objv[0]);
+    Tcl_IncrRefCount (objv[1]);
+    Tcl_IncrRefCount (cmd_key);
+
+    int depth = 0;
+    if (Tcl_EvalObjv (interp, 2, objv, 0) == TCL_OK) {
+        Tcl_GetIntFromObj (NULL, Tcl_GetObjResult (interp), &depth);
+    }
+
+    GString *stack = g_string_truncate (tclln->profile_stack, 0);
+
+    for (int level = 1; level <= depth; level++) {
+        objv[2] = Tcl_NewIntObj (level);
+        Tcl_IncrRefCount (objv[2]);
+
+        Tcl_Obj *cmd = NULL;
+        if (Tcl_EvalObjv (interp, 3, objv, 0) == TCL_OK) {
+            Tcl_DictObjGet (NULL, Tcl_GetObjResult (interp), cmd_key, &cmd);
+        }
+
+        Tcl_DecrRefCount (objv[2]);
+
+        if (cmd == NULL) continue;
+
+        const char *word = Tcl_GetString (cmd);
+        while (isspace ((unsigned char) *word)) word++;
+
+        if (stack->len > 0) {
+            g_string_append_c (stack, ';');
+        }
+        for (; (*word != '\0') && !isspace ((unsigned char) *word); word++) {
+            g_string_append_c (stack, (*word == ';' ? ':' : *word));
+        }
+    }
+
+    Tcl_DecrRefCount (objv[0]);
+    Tcl_DecrRefCount (objv[1]);
+    Tcl_DecrRefCount (cmd_key);
+
+    /* nothing evaluated */
+    if (stack->len == 0) return;
+
+    guint64 *samples = (guint64 *) g_hash_table_lookup (tclln->profile_stacks, stack->str);
+    if (samples == NULL) {
+        samples = g_new0 (guint64, 1);
+        g_hash_table_insert (tclln->profile_stacks, g_strdup (stack->str), samples);
+    }
+
+    *samples += weight;
+}
+
+/* tclln::profile start ?interval_us? | stop | write file_name */
+static int profile_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    static const char *subcommands [] = {"start", "stop", "write", NULL};
+    enum {PROFILE_START, PROFILE_STOP, PROFILE_WRITE};
+
+    int index;
+
+    if (objc < 2) {
+        Tcl_WrongNumArgs (interp, 1, objv, "start ?interval_us? | stop | write fileName");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj (interp, objv[1], subcommands, "subcommand", 0, &index) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    switch (index) {
+        case PROFILE_START: {
+            long interval_us = 0;
+
+            if (objc > 3) {
+                Tcl_WrongNumArgs (interp, 2, objv, "?interval_us?");
+                return TCL_ERROR;
+            }
+            if ((objc == 3) && (Tcl_GetLongFromObj (interp, objv[2], &interval_us) != TCL_OK)) {
+                return TCL_ERROR;
+            }
+            if (!tclln_profile_start (tclln, (interval_us > 0 ? interval_us : 0))) {
+                Tcl_SetObjResult (interp, Tcl_NewStringObj ("profiler is already running", -1));
+                return TCL_ERROR;
+            }
+            break;
+        }
+        case PROFILE_STOP:
+            if (objc != 2) {
+                Tcl_WrongNumArgs (interp, 2, objv, NULL);
+                return TCL_ERROR;
+            }
+            tclln_profile_stop (tclln);
+            break;
+
+        case PROFILE_WRITE:
+            if (objc != 3) {
+                Tcl_WrongNumArgs (interp, 2, objv, "fileName");
+                return TCL_ERROR;
+            }
+            if (!tclln_profile_write (tclln, Tcl_GetString (objv[2]))) {
+                Tcl_SetObjResult (interp, Tcl_ObjPrintf ("could not write profile to \"%s\"", Tcl_GetString (objv[2])));
+                return TCL_ERROR;
+            }
+            break;
+    }
+
+    return TCL_OK;
+}
+
+/*************************************************
+ * allocator and arenas
+ *************************************************/
+
+/* Data of tclln itself and of linenoise is allocated by alloc_malloc/alloc_free.
+ * Temporary data of a request (completion candidates, quoted result elements) is
+ * taken from an arena: blocks are filled one after the other and released
+ * together by arena_reset when the request is done. */
+
+void tclln_set_allocator (void *(*malloc_proc) (size_t size), void *(*realloc_proc) (void *ptr, size_t size),
+                void (*free_proc) (void *ptr))
+{
+    alloc_malloc  = (malloc_proc  != NULL ? malloc_proc  : malloc);
+    alloc_realloc = (realloc_proc != NULL ? realloc_proc : realloc);
+    alloc_free    = (free_proc    != NULL ? free_proc    : free);
+
+    linenoiseSetAllocator (alloc_malloc, alloc_realloc, alloc_free);
+}
+
+static void arena_init (struct arena *arena, size_t block_size)
+{
+    arena->blocks     = NULL;
+    arena->block_size = block_size;
+}
+
+/* returns: NULL if the allocator fails */
+static void *arena_alloc (struct arena *arena, size_t size)
+{
+    /* keep pointers aligned */
+    size = (size + arena_alignment - 1) & ~(arena_alignment - 1);
+
+    struct arena_block *block = arena->blocks;
+
+    if ((block == NULL) || (block->used + size > block->size)) {
+        size_t block_size = (size > arena->block_size ? size : arena->block_size);
+
+        block = (struct arena_block *) alloc_malloc (sizeof (struct arena_block) + block_size);
+        if (block == NULL) return NULL;
+
+        block->next   = arena->blocks;
+        block->size   = block_size;
+        block->used   = 0;
+        arena->blocks = block;
+    }
+
+    void *data = block->data + block->used;
+    block->used += size;
+
+    return data;
+}
+
+/* copy of string - length -1 for null terminated string */
+static char *arena_strdup (struct arena *arena, const char *string, gssize length)
+{
+    if (length < 0) length = strlen (string);
+
+    char *copy = (char *) arena_alloc (arena, length + 1);
+    if (copy == NULL) return NULL;
+
+    memcpy (copy, string, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+static char *arena_concat (struct arena *arena, const char *first, const char *second)
+{
+    size_t first_len  = strlen (first);
+    size_t second_len = strlen (second);
+
+    char *result = (char *) arena_alloc (arena, first_len + second_len + 1);
+    if (result == NULL) return NULL;
+
+    memcpy (result, first, first_len);
+    memcpy (result + first_len, second, second_len + 1);
+
+    return result;
+}
+
+/* release all data - one regular block is kept for the next request */
+static void arena_reset (struct arena *arena)
+{
+    struct arena_block *kept = NULL;
+
+    while (arena->blocks != NULL) {
+        struct arena_block *block = arena->blocks;
+        arena->blocks = block->next;
+
+        if ((kept == NULL) && (block->size == arena->block_size)) {
+            kept = block;
+        } else {
+            alloc_free (block);
+        }
+    }
+
+    if (kept != NULL) {
+        kept->next = NULL;
+        kept->used = 0;
+    }
+
+    arena->blocks = kept;
+}
+
+static void arena_free (struct arena *arena)
+{
+    arena_reset (arena);
+
+    if (arena->blocks != NULL) {
+        alloc_free (arena->blocks);
+        arena->blocks = NULL;
+    }
+}
+
+/* bytes of allocated blocks */
+static size_t arena_size (const struct arena *arena)
+{
+    size_t size = 0;
+
+    for (const struct arena_block *block = arena->blocks; block != NULL; block = block->next) {
+        size += sizeof (struct arena_block) + block->size;
+    }
+
+    return size;
+}
+
+
+/*************************************************
+ * memory accounting
+ *************************************************/
+
+/* Areas are measured on request by walking their contents: strings are counted with
+ * their terminating null, list nodes with sizeof (GList), arenas with their blocks. Storage kept by allocators
+ * is not visible here - tclln_memory_trim reports what malloc got back. */
+
+bool tclln_memory_stats (struct tclln_data *tclln, int area, size_t *bytes, size_t *entries)
+{
+    if (tclln == NULL) return false;
+
+    size_t n_bytes   = 0;
+    size_t n_entries = 0;
+
+    switch (area) {
+        case TCLLN_MEMORY_COMPLETION_STRINGS:
+            n_bytes   = arena_size (&tclln->completion_arena) + tclln->completion_candidates->len * sizeof (gpointer);
+            n_entries = tclln->completion_candidates->len;
+            break;
+
+        case TCLLN_MEMORY_COMPLETION_ARG_STRINGS: {
+            /* strings are shared between commands - count each once */
+            struct memory_strings strings;
+            strings.seen  = g_hash_table_new (g_direct_hash, g_direct_equal);
+            strings.bytes = 0;
+
+            g_hash_table_foreach (tclln->completion_arg_table, memory_count_arg_strings, &strings);
+
+            n_bytes   = strings.bytes;
+            n_entries = g_hash_table_size (strings.seen);
+
+            g_hash_table_destroy (strings.seen);
+            break;
+        }
+
+        case TCLLN_MEMORY_COMPLETION_ARG_TABLE:
+            g_hash_table_foreach (tclln->completion_arg_table, memory_count_arg_lists, &n_entries);
+            n_bytes = n_entries * sizeof (const char *)
+                    + g_hash_table_size (tclln->completion_arg_table) * sizeof (struct default_completion);
+            break;
+
+        case TCLLN_MEMORY_HISTORY:
+            linenoiseMemoryUsage (&n_bytes, &n_entries, NULL);
+            break;
+
+        case TCLLN_MEMORY_LINE_BUFFER:
+            linenoiseMemoryUsage (NULL, NULL, &n_bytes);
+            n_entries = (n_bytes > 0 ? 1 : 0);
+            break;
+
+        case TCLLN_MEMORY_RESULT_BUFFER:
+            if (tclln->result_buffer != NULL) {
+                n_bytes   = result_buffer_size;
+                n_entries = 1;
+            }
+            break;
+
+        case TCLLN_MEMORY_COMMAND_INDEX:
+            index_usage (tclln->command_index.namespaces, &n_bytes, &n_entries);
+
+            if (tclln->command_index.qualified != NULL) {
+                for (guint i = 0; i < tclln->command_index.qualified->len; i++) {
+                    n_bytes += sizeof (gpointer) + strlen (g_ptr_array_index (tclln->command_index.qualified, i)) + 1;
+                }
+            }
+            break;
+
+        case TCLLN_MEMORY_VARIABLE_INDEX:
+            variable_index_usage (&tclln->variable_index, &n_bytes, &n_entries);
+            break;
+
+        case TCLLN_MEMORY_DIRECTORY_CACHE:
+            n_bytes   = tclln->directory_cache_bytes;
+            n_entries = g_queue_get_length (&tclln->directory_lru);
+            break;
+
+        case TCLLN_MEMORY_SCRIPT_CACHE:
+            n_bytes   = tclln->script_cache_bytes;
+            n_entries = g_queue_get_length (&tclln->script_lru);
+            break;
+
+        default:
+            return false;
+    }
+
+    if (bytes   != NULL) *bytes   = n_bytes;
+    if (entries != NULL) *entries = n_entries;
+
+    return true;
+}
+
+size_t tclln_memory_trim (struct tclln_data *tclln)
+{
+    if (tclln == NULL) return 0;
+
+    long memory_start = memory_in_use ();
+
+    /* completion candidates are generated again on each completion */
+    g_ptr_array_free (tclln->completion_candidates, true);
+    tclln->completion_candidates = g_ptr_array_new ();
+    arena_free (&tclln->completion_arena);
+    arena_free (&tclln->eval_arena);
+
+    /* indexes are built again on next completion - traces stay on commands and variables */
+    command_index_free (&tclln->command_index);
+    variable_index_free (tclln);
+    directory_cache_free (tclln);
+    script_cache_free (tclln);
+
+    /* argument strings: replaced argument lists leave their strings behind - copy the
+     * referenced ones to new storage */
+    struct memory_compaction compaction;
+    compaction.strings = g_string_chunk_new (32);
+    compaction.table   = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, completion_table_free_args);
+
+    g_hash_table_foreach (tclln->completion_arg_table, memory_compact_arg_strings, &compaction);
+
+    /* argument arrays moved to the new table */
+    g_hash_table_steal_all (tclln->completion_arg_table);
+    g_hash_table_destroy (tclln->completion_arg_table);
+    g_string_chunk_free (tclln->completion_arg_strings);
+
+    tclln->completion_arg_table   = compaction.table;
+    tclln->completion_arg_strings = compaction.strings;
+
+    /* line buffer is in use while a line is edited */
+    if ((tclln->shell == NULL) || !tclln->shell->editing) {
+        linenoiseReleaseBuffer ();
+    }
+
+    alloc_free (tclln->result_buffer);
+    tclln->result_buffer = NULL;
+
+#ifdef __GLIBC__
+    malloc_trim (0);
+#endif
+
+    long memory_end = memory_in_use ();
+
+    return (memory_start > memory_end ? memory_start - memory_end : 0);
+}
+
+static void memory_count_arg_strings (gpointer key, gpointer value, gpointer data)
+{
+    struct memory_strings     *strings = (struct memory_strings *) data;
+    struct default_completion *args    = (struct default_completion *) value;
+
+    if (g_hash_table_add (strings->seen, key)) {
+        strings->bytes += strlen ((const char *) key) + 1;
+    }
+
+    for (int i = 0; i < args->n_args; i++) {
+        if (g_hash_table_add (strings->seen, (gpointer) args->args[i])) {
+            strings->bytes += strlen (args->args[i]) + 1;
+        }
+    }
+}
+
+static void memory_count_arg_lists (gpointer key, gpointer value, gpointer data)
+{
+    size_t *n_entries = (size_t *) data;
+
+    *n_entries += ((struct default_completion *) value)->n_args;
+}
+
+/* move argument array to compacted table, its strings to compacted storage - sorting is kept */
+static void memory_compact_arg_strings (gpointer key, gpointer value, gpointer data)
+{
+    struct memory_compaction  *compaction = (struct memory_compaction *) data;
+    struct default_completion *args       = (struct default_completion *) value;
+
+    const char **arg_array = (const char **) args->args;
+
+    for (int i = 0; i < args->n_args; i++) {
+        arg_array[i] = g_string_chunk_insert_const (compaction->strings, arg_array[i]);
+    }
+
+    args->command = g_string_chunk_insert_const (compaction->strings, (const char *) key);
+
+    g_hash_table_insert (compaction->table, (gpointer) args->command, args);
+}
+
+/* tclln::memory stats | trim */
+static int memory_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct tclln_data *tclln = (struct tclln_data *) client_data;
+
+    static const char *subcommands [] = {"stats", "trim", NULL};
+    enum {MEMORY_STATS, MEMORY_TRIM};
+
+    int index;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs (interp, 1, objv, "stats | trim");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj (interp, objv[1], subcommands, "subcommand", 0, &index) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    if (index == MEMORY_TRIM) {
+        Tcl_SetObjResult (interp, Tcl_NewWideIntObj ((Tcl_WideInt) tclln_memory_trim (tclln)));
+        return TCL_OK;
+    }
+
+    /* area -> {bytes entries} */
+    Tcl_Obj *result = Tcl_NewDictObj ();
+
+    for (int area = 0; area < TCLLN_MEMORY_AREAS; area++) {
+        size_t bytes, entries;
+        tclln_memory_stats (tclln, area, &bytes, &entries);
+
+        Tcl_Obj *stats = Tcl_NewDictObj ();
+        Tcl_DictObjPut (NULL, stats, Tcl_NewStringObj ("bytes", -1),   Tcl_NewWideIntObj ((Tcl_WideInt) bytes));
+        Tcl_DictObjPut (NULL, stats, Tcl_NewStringObj ("entries", -1), Tcl_NewWideIntObj ((Tcl_WideInt) entries));
+
+        Tcl_DictObjPut (NULL, result, Tcl_NewStringObj (memory_area_names[area], -1), stats);
+    }
+
+    Tcl_SetObjResult (interp, result);
+
+    return TCL_OK;
+}
+
+/*************************************************
+ * prompt string
+ *************************************************/
+
+void tclln_set_prompt (struct tclln_data *tclln, const char *prompt_main, const char *prompt_multiline)
+{
+    if (prompt_main == NULL) {
+        tclln->prompt_string_main = default_prompt_main;
+    } else {
+        tclln->prompt_string_main = prompt_main;
+    }
+
+    if (prompt_multiline == NULL) {
+        tclln->prompt_string_multiline = default_prompt_multiline;
+    } else {
+        tclln->prompt_string_multiline = prompt_multiline;
+    }
+}
+
+void tclln_set_single_row (struct tclln_data *tclln, bool single_row)
+{
+    if (tclln == NULL) return;
+
+    tclln->single_row = single_row;
+}
+
+void tclln_set_completion_budget (struct tclln_data *tclln, unsigned long budget_ms)
+{
+    if (tclln == NULL) return;
+
+    tclln->completion_budget_ms = budget_ms;
+}
+
+void tclln_set_fuzzy_completion (struct tclln_data *tclln, bool fuzzy)
+{
+    if (tclln == NULL) return;
+
+    tclln->fuzzy_completion = fuzzy;
+}
+
+static const char *prompt (struct tclln_data *tclln) {
+    if (tclln == NULL) {
+        return default_prompt_main;
+    } else {
+        if (tclln->multiline) {
+            return tclln->prompt_string_multiline;
+        } else {
+            return tclln->prompt_string_main;
+        }
+    }
+}
+
+
+/*************************************************
+ * completion
+ *************************************************/
+
+void tclln_provide_completion_command (struct tclln_data *tclln, const char *command_name)
+{
+    if (tclln == NULL) return;
+
+    if (command_name == NULL) command_name = "tclln::add_completion";
+
+    if (tclln->completion_command_name != NULL) {
+        g_free (tclln->completion_command_name);
+    }
+    tclln->completion_command_name = g_strdup (command_name);
+
+    Tcl_CreateObjCommand (tclln->tcl_interp, command_name, tcl_completion_add_command, (ClientData) tclln, NULL);
+}
+
+static int tcl_completion_add_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    if (objc < 3) {
+        Tcl_SetObjResult (interp, Tcl_NewStringObj ("wrong number of arguments: expeted at least command name and 1 possible argument", -1));
+        return TCL_ERROR;
+    }
+
+    const char *command_name = Tcl_GetString (objv[1]);
+
+    struct tclln_data *tclln = (struct tclln_data*) client_data;
+    if (tclln == NULL) {
+        return TCL_ERROR;
+    }
+
+    const char **arg_list = (const char **) alloc_malloc (sizeof (const char *) * (objc-1));
+    if (arg_list == NULL) {
+        return TCL_ERROR;
+    }
+
+    for (int i = 0; i < objc-2; i++) {
+        arg_list[i] = Tcl_GetString (objv[2+i]);
+    }
+    arg_list[objc-2] = NULL;
+
+    completion_table_add_command (tclln, command_name, arg_list);
+
+    alloc_free (arg_list);
+
+    Tcl_SetObjResult (interp, Tcl_NewBooleanObj (true));
+
+    return TCL_OK;
+}
+
+/* arguments are stored like the defaults: a sorted array without duplicates, so matches of a
+ * prefix are a range found by binary search */
+static void completion_table_add_command (struct tclln_data *tclln, const char *command, const char *const arg_complete_list[])
+{
+    int n_args = 0;
+
+    while (arg_complete_list[n_args] != NULL) {
+        n_args++;
+    }
+
+    const char **arg_array = g_new (const char *, n_args + 1);
+
+    for (int i = 0; i < n_args; i++) {
+        arg_array[i] = g_string_chunk_insert_const (tclln->completion_arg_strings, arg_complete_list[i]);
+    }
+
+    qsort (arg_array, n_args, sizeof (const char *), completion_compare);
+
+    /* equal strings share storage */
+    int n_unique = 0;
+
+    for (int i = 0; i < n_args; i++) {
+        if ((n_unique > 0) && (arg_array[n_unique - 1] == arg_array[i])) continue;
+
+        arg_array[n_unique++] = arg_array[i];
+    }
+
+    arg_array[n_unique] = NULL;
+
+    struct default_completion *args = g_new (struct default_completion, 1);
+
+    args->command = g_string_chunk_insert_const (tclln->completion_arg_strings, command);
+    args->args    = arg_array;
+    args->n_args  = n_unique;
+
+    /* frees arguments added before */
+    g_hash_table_replace (tclln->completion_arg_table, (gpointer) args->command, args);
+}
+
+static void completion_table_free_args (gpointer data)
+{
+    struct default_completion *args = (struct default_completion *) data;
+
+    g_free ((gpointer) args->args);
+    g_free (args);
+}
+
+/* default arguments of command (generated by gen_completion)
+ * returns: NULL if there are none */
+static const struct default_completion *completion_table_lookup_default (const char *command)
+{
+    uint32_t slot  = completion_hash (command, default_completion_seed) & ((1 << DEFAULT_COMPLETION_HASH_BITS) - 1);
+    int      index = default_completion_index[slot];
+
+    if (index < 0) return NULL;
+    if (strcmp (default_completions[index].command, command) != 0) return NULL;
+
+    return &default_completions[index];
+}
+
+
+static void completion (const char *input_buffer, linenoiseCompletions *linenoise_completion)
+{
+    struct tclln_data *tclln = tclln_completion;
+
+    if (tclln == NULL) return;
+
+    completion_lines (tclln, input_buffer);
+
+    for (guint i = 0; i < tclln->completion_candidates->len; i++) {
+        linenoiseAddCompletion (linenoise_completion, g_ptr_array_index (tclln->completion_candidates, i));
+    }
+}
+
+char **tclln_complete (struct tclln_data *tclln, const char *input)
+{
+    if (tclln == NULL) return NULL;
+
+    completion_lines (tclln, input);
+
+    GPtrArray *candidates = tclln->completion_candidates;
+
+    if (candidates->len == 0) {
+        return NULL;
+    }
+
+    /* array and strings in one block - tclln_free_completions frees it at once */
+    size_t size = sizeof (char *) * (candidates->len + 1);
+
+    for (guint i = 0; i < candidates->len; i++) {
+        size += strlen (g_ptr_array_index (candidates, i)) + 1;
+    }
+
+    char **completions = (char **) alloc_malloc (size);
+    if (completions == NULL) return NULL;
+
+    char *strings = (char *) (completions + candidates->len + 1);
+
+    for (guint i = 0; i < candidates->len; i++) {
+        size_t length = strlen (g_ptr_array_index (candidates, i)) + 1;
+
+        completions[i] = memcpy (strings, g_ptr_array_index (candidates, i), length);
+        strings += length;
+    }
+    completions[candidates->len] = NULL;
+
+    return completions;
+}
+
+/* fill completion_candidates with sorted (fuzzy: ranked) completed lines of input */
+static void completion_lines (struct tclln_data *tclln, const char *input)
+{
+    /* strings of previous completion are released */
+    g_ptr_array_set_size (tclln->completion_candidates, 0);
+    arena_reset (&tclln->completion_arena);
+
+    /* empty line? */
+    if (strcmp (input, "") == 0) return;
+
+    tclln->completion_begin = g_string_assign (tclln->completion_begin, input);
+
+    /* generate completion data */
+    completion_generate (tclln);
+
+    if (tclln->fuzzy_completion) {
+        /* the word follows the beginning of line kept by completion_generate */
+        completion_rank (tclln->completion_candidates, input + tclln->completion_begin->len, &tclln->completion_arena);
+    } else {
+        g_ptr_array_sort (tclln->completion_candidates, completion_compare);
+    }
+
+    /* prepend beginning of line */
+    for (guint i = 0; i < tclln->completion_candidates->len; i++) {
+        char **candidate = (char **) &g_ptr_array_index (tclln->completion_candidates, i);
+
+        *candidate = arena_concat (&tclln->completion_arena, tclln->completion_begin->str, *candidate);
+    }
+
+    completion_remove_failed (tclln->completion_candidates);
+}
+
+/* candidates are (pointers to) strings */
+static gint completion_compare (gconstpointer a, gconstpointer b)
+{
+    return strcmp (*(const char **) a, *(const char **) b);
+}
+
+/* drop candidates whose allocation failed */
+static void completion_remove_failed (GPtrArray *candidates)
+{
+    guint n_kept = 0;
+
+    for (guint i = 0; i < candidates->len; i++) {
+        gpointer candidate = g_ptr_array_index (candidates, i);
+
+        if (candidate != NULL) {
+            g_ptr_array_index (candidates, n_kept++) = candidate;
+        }
+    }
+
+    g_ptr_array_set_size (candidates, n_kept);
+}
+
+void tclln_free_completions (char **completions)
+{
+    alloc_free (completions);
+}
+
+static void completion_generate (struct tclln_data *tclln)
+{
+
+    /* find out what to complete */
+    int pos_cmd = 0;
+    int len_cmd = 0;
+    int pos_start = strlen (tclln->completion_begin->str);
+
+    char *str_cmd;
+    char *str_base;
+
+    const char *in_buf = tclln->completion_begin->str;
+
+    /* find beginning of relevant section */
+    int brace_count = 0;
+    int pos_tmp = tclln->completion_begin->len - 1;
+    while (pos_tmp >= 0) {
+        char current = in_buf[pos_tmp];
+        if (current == ']') brace_count++;
+        if (current == '}') brace_count++;
+        if (current == '[') brace_count--;
+        if (current == '{') brace_count--;
+        if (brace_count < 0) break;
+        pos_tmp --;
+    }
+    pos_cmd = pos_tmp + 1;
+
+    while (isspace (in_buf[pos_cmd]) && (in_buf[pos_cmd] != '\0')) pos_cmd++;
+    while ((!isspace (in_buf[pos_cmd + len_cmd])) && (in_buf[pos_cmd + len_cmd] != '\0')) len_cmd++;
+    str_cmd = arena_strdup (&tclln->completion_arena, &(in_buf[pos_cmd]), len_cmd);
+
+    while ((!isspace (in_buf[pos_start])) && (pos_start > pos_cmd)) pos_start--;
+    if (pos_start > pos_cmd) pos_start++;
+    str_base = arena_strdup (&tclln->completion_arena, &(in_buf[pos_start]), -1);
+
+    if ((str_cmd == NULL) || (str_base == NULL)) return;
+
+    if (pos_start == pos_cmd) {
+        /* nothing ? */
+        if (len_cmd == 0) return;
+
+        /* command or var */
+        if (*str_cmd != '$') {
+            /* complete procs/commands */
+            completion_generate_tcl_procs (tclln, str_cmd);
+            g_string_truncate (tclln->completion_begin, pos_cmd);
+            return;
+        }
+    }
+
+    /* variable or argument/files */
+    if (*str_base == '$') {
+        /* variable */
+        str_base++;
+        pos_start++;
+
+        /* nothing? */
+        if (*str_base == '\0') return;
+
+        completion_generate_tcl_vars (tclln, str_base);
+        g_string_truncate (tclln->completion_begin, pos_start);
+        return;
+    } else {
+        /* files are read meanwhile - the budget includes the arguments */
+        gint64 deadline = (tclln->completion_budget_ms == 0) ? 0 : g_get_monotonic_time () + tclln->completion_budget_ms * 1000;
+
+        completion_generate_files_start (tclln, str_base);
+        /* argument: all of them are ranked by fuzzy completion */
+        completion_generate_args (tclln->completion_arg_table, tclln->completion_candidates, str_cmd, tclln->fuzzy_completion ? "" : str_base);
+        /* files */
+        completion_generate_files (tclln, str_base, deadline);
+    }
+
+    g_string_truncate (tclln->completion_begin, pos_start);
+
+    return;
+}
+
+/* variables starting with base - array keys if base is "name(key..."
+ * fuzzy completion gets all variables of the namespace (all keys) to rank */
+static void completion_generate_tcl_vars (struct tclln_data *tclln, const char *base)
+{
+    struct arena *arena      = &tclln->completion_arena;
+    GPtrArray    *candidates = tclln->completion_candidates;
+    int          limit       = tclln->fuzzy_completion ? G_MAXINT : completion_max_variables;
+
+    const char *qualifier;
+    const char *tail;
+    const char *key = strchr (base, '(');
+
+    if (key == NULL) {
+        const char *ns_name = index_select_namespace (arena, base, &qualifier, &tail);
+        if (ns_name == NULL) return;
+
+        struct index_namespace *ns = variable_index_namespace (tclln, ns_name);
+        if (ns == NULL) return;
+
+        index_add_matches (ns->names, tclln->fuzzy_completion ? "" : tail, qualifier, arena, candidates, limit);
+        return;
+    }
+
+    /* array keys */
+    const char *array_base = arena_strdup (arena, base, key - base);
+    const char *array_head = arena_strdup (arena, base, key - base + 1);
+
+    if ((array_base == NULL) || (array_head == NULL)) return;
+
+    const char *ns_name = index_select_namespace (arena, array_base, &qualifier, &tail);
+    if (ns_name == NULL) return;
+
+    const char *array_name = arena_concat (arena, (strcmp (ns_name, "::") == 0) ? "" : ns_name, arena_concat (arena, "::", tail));
+    if (array_name == NULL) return;
+
+    struct variable_array *array = variable_index_array (tclln, array_name);
+    if (array == NULL) return;
+
+    key = tclln->fuzzy_completion ? "" : key + 1;
+
+    int len   = strlen (key);
+    int added = 0;
+
+    for (guint i = index_find (array->keys, key); (i < array->keys->len) && (added < limit); i++, added++) {
+        const char *array_key = g_ptr_array_index (array->keys, i);
+
+        if (strncmp (array_key, key, len) != 0) break;
+
+        char *element = arena_concat (arena, array_head, array_key);
+
+        g_ptr_array_add (candidates, (element == NULL) ? NULL : arena_concat (arena, element, ")"));
+    }
+}
+
+/* procs are commands too - one lookup in the command index */
+static void completion_generate_tcl_procs (struct tclln_data *tclln, const char *base)
+{
+    if (!command_index_validate (tclln)) return;
+
+    if (tclln->fuzzy_completion) {
+        command_index_all (&tclln->command_index, tclln->completion_candidates, base);
+    } else {
+        command_index_lookup (&tclln->command_index, &tclln->completion_arena, tclln->completion_candidates, base);
+    }
+}
+
+static void completion_generate_args (GHashTable *arg_table, GPtrArray *candidates, const char *command, const char *base)
+{
+    if (command == NULL) return;
+
+    /* remove "::" at beginning before lookup */
+    if (strlen (command) > 2) {
+        if ((command[0] == ':') && (command[1] == ':')) {
+            command = command+2;
+        }
+    }
+
+    int len = strlen (base);
+
+    /* arguments added at runtime replace defaults */
+    const struct default_completion *args = (const struct default_completion *) g_hash_table_lookup (arg_table, command);
+
+    if (args == NULL) {
+        args = completion_table_lookup_default (command);
+    }
+
+    if (args == NULL) return;
+
+    /* sorted: find first argument >= base, matches follow */
+    int lower = 0;
+    int upper = args->n_args;
+
+    while (lower < upper) {
+        int middle = (lower + upper) / 2;
+
+        if (strcmp (args->args[middle], base) < 0) {
+            lower = middle + 1;
+        } else {
+            upper = middle;
+        }
+    }
+
+    for (int i = lower; i < args->n_args; i++) {
+        if (strncmp (args->args[i], base, len) != 0) break;
+
+        g_ptr_array_add (candidates, (gpointer) args->args[i]);
+    }
+}
+
+/* directory part of base with trailing '/' - "./" if there is none
+ *   file: set to the rest of base
+ * returns: NULL if out of memory */
+static const char *completion_files_dir (struct arena *arena, const char *base, const char **file)
+{
+    const char *slash = strrchr (base, '/');
+
+    if (slash == NULL) {
+        *file = base;
+        return "./";
+    }
+
+    *file = slash + 1;
+
+    return arena_strdup (arena, base, slash + 1 - base);
+}
+
+/* read directory of base by a thread meanwhile - unless its listing is current */
+static void completion_generate_files_start (struct tclln_data *tclln, const char *base)
+{
+    const char *file;
+    const char *dir = completion_files_dir (&tclln->completion_arena, base, &file);
+
+    if (dir == NULL) return;
+
+    directory_scans_collect (tclln);
+
+    struct directory_listing *listing;
+
+    if (!directory_cache_lookup (tclln, dir, &listing)) {
+        directory_scan_start (tclln, dir);
+    }
+}
+
+/* files of base - a directory that is read until deadline (0: no limit) is waited for, after it an
+ * outdated listing (if any) is used and the next completion offers the rest */
+static void completion_generate_files (struct tclln_data *tclln, const char *base, gint64 deadline)
+{
+    const char *file;
+    const char *dir = completion_files_dir (&tclln->completion_arena, base, &file);
+
+    if (dir == NULL) return;
+
+    struct directory_listing *listing;
+
+    if (!directory_cache_lookup (tclln, dir, &listing)) {
+        struct directory_listing *read = directory_scan_wait (tclln, dir, deadline);
+
+        if (read != NULL) {
+            listing = read;
+        }
+    }
+
+    if (listing == NULL) return;
+
+    /* with directory if given - fuzzy completion ranks all files */
+    index_add_matches (listing->names, tclln->fuzzy_completion ? "" : file, (file == base) ? NULL : dir,
+                       &tclln->completion_arena, tclln->completion_candidates, G_MAXINT);
+}
+
+/*************************************************
+ * fuzzy matching
+ *************************************************/
+
+/* keep candidates containing the characters of pattern in order, best matches first - completion_max_fuzzy
+ * of them; a directory or qualifier all candidates start with isn't matched, if nothing or more than
+ * fuzzy_max_pattern characters remain candidates starting with pattern are kept sorted */
+static void completion_rank (GPtrArray *candidates, const char *pattern, struct arena *arena)
+{
+    int   len    = strlen (pattern);
+    int   skip   = len;
+    guint n_kept = 0;
+
+    for (guint i = 0; (i < candidates->len) && (skip > 0); i++) {
+        const char *candidate = g_ptr_array_index (candidates, i);
+        int        same       = 0;
+
+        if (candidate == NULL) continue;
+
+        while ((same < skip) && (candidate[same] == pattern[same])) same++;
+
+        skip = same;
+    }
+
+    /* up to a separator: the rest starts a word like the start of a name */
+    while ((skip > 0) && (strchr (fuzzy_separators, pattern[skip - 1]) == NULL)) skip--;
+
+    if ((len == skip) || (len - skip > fuzzy_max_pattern)) {
+        for (guint i = 0; i < candidates->len; i++) {
+            const char *candidate = g_ptr_array_index (candidates, i);
+
+            if ((candidate != NULL) && (strncmp (candidate, pattern, len) == 0)) {
+                g_ptr_array_index (candidates, n_kept++) = (gpointer) candidate;
+            }
+        }
+
+        g_ptr_array_set_size (candidates, n_kept);
+        g_ptr_array_sort (candidates, completion_compare);
+    } else {
+        /* released with the arena by the next completion */
+        gint16             *scores  = (gint16 *) arena_alloc (arena, sizeof (gint16) * candidates->len);
+        struct fuzzy_match *matches = (struct fuzzy_match *) arena_alloc (arena, sizeof (struct fuzzy_match) * completion_max_fuzzy);
+
+        if ((scores == NULL) || (matches == NULL)) {
+            g_ptr_array_set_size (candidates, 0);
+            return;
+        }
+
+        fuzzy_score ((const char *const *) candidates->pdata, candidates->len, skip, pattern + skip, scores, arena);
+
+        /* heap of the best matches with the worst of them first - most matches rank below it */
+        for (guint i = 0; i < candidates->len; i++) {
+            if (scores[i] <= fuzzy_no_match) continue;
+
+            /* ranks below the worst kept match - no need for its length */
+            if ((n_kept == (guint) completion_max_fuzzy) && (scores[i] < matches[0].score)) continue;
+
+            struct fuzzy_match match;
+
+            match.name   = g_ptr_array_index (candidates, i);
+            match.score  = scores[i];
+            match.length = strlen (match.name);
+
+            if (n_kept < (guint) completion_max_fuzzy) {
+                matches[n_kept] = match;
+                fuzzy_heap_up (matches, n_kept++);
+            } else if (completion_rank_compare (&match, &matches[0]) < 0) {
+                matches[0] = match;
+                fuzzy_heap_down (matches, n_kept, 0);
+            }
+        }
+
+        qsort (matches, n_kept, sizeof (struct fuzzy_match), completion_rank_compare);
+
+        for (guint i = 0; i < n_kept; i++) {
+            g_ptr_array_index (candidates, i) = (gpointer) matches[i].name;
+        }
+
+        g_ptr_array_set_size (candidates, n_kept);
+    }
+
+    if (candidates->len > (guint) completion_max_fuzzy) {
+        g_ptr_array_set_size (candidates, completion_max_fuzzy);
+    }
+}
+
+/* restore heap order of matches (worst first) after adding at pos */
+static void fuzzy_heap_up (struct fuzzy_match *heap, guint pos)
+{
+    while (pos > 0) {
+        guint parent = (pos - 1) / 2;
+
+        if (completion_rank_compare (&heap[parent], &heap[pos]) >= 0) break;
+
+        struct fuzzy_match swap = heap[parent];
+        heap[parent] = heap[pos];
+        heap[pos]    = swap;
+
+        pos = parent;
+    }
+}
+
+/* restore heap order of n_heap matches after replacing at pos */
+static void fuzzy_heap_down (struct fuzzy_match *heap, guint n_heap, guint pos)
+{
+    for (;;) {
+        guint worst = pos;
+        guint left  = 2 * pos + 1;
+        guint right = 2 * pos + 2;
+
+        if ((left  < n_heap) && (completion_rank_compare (&heap[left],  &heap[worst]) > 0)) worst = left;
+        if ((right < n_heap) && (completion_rank_compare (&heap[right], &heap[worst]) > 0)) worst = right;
+
+        if (worst == pos) break;
+
+        struct fuzzy_match swap = heap[worst];
+        heap[worst] = heap[pos];
+        heap[pos]   = swap;
+
+        pos = worst;
+    }
+}
+
+/* higher score first, then shorter, then sorted */
+static gint completion_rank_compare (gconstpointer a, gconstpointer b)
+{
+    const struct fuzzy_match *match_a = (const struct fuzzy_match *) a;
+    const struct fuzzy_match *match_b = (const struct fuzzy_match *) b;
+
+    if (match_a->score  != match_b->score)  return match_b->score - match_a->score;
+    if (match_a->length != match_b->length) return match_a->length - match_b->length;
+
+    return strcmp (match_a->name, match_b->name);
+}
+
+/* score names (or NULL) after skip characters by matching pattern of 1 to fuzzy_max_pattern characters -
+ * fuzzy_no_match or below if a name doesn't contain it; a pattern without uppercase matches both cases
+ * names containing the pattern characters in order are transposed to fuzzy_lanes characters per position
+ * for fuzzy_score_batch - the others (most names, usually) are not scored */
+static void fuzzy_score (const char *const *names, guint n_names, int skip, const char *pattern, gint16 *scores,
+                         struct arena *arena)
+{
+    bool fold = true;
+
+    for (const char *c = pattern; *c != '\0'; c++) {
+        if (isupper ((unsigned char) *c)) fold = false;
+    }
+
+    guint8  *chars      = NULL;
+    size_t  chars_size  = 0;
+    gint16  batch_scores [fuzzy_lanes];
+    guint   indexes      [fuzzy_lanes];
+    int     lengths      [fuzzy_lanes];
+    int     n_batch      = 0;
+    int     length       = 0;
+
+    for (guint i = 0; i < n_names; i++) {
+        scores[i] = fuzzy_no_match;
+
+        if (names[i] != NULL) {
+            /* pattern characters in order - memchr finds them faster than the alignment rejects a name */
+            const char *name        = names[i] + skip;
+            int        name_length  = strnlen (name, fuzzy_max_length);
+            const char *at          = name;
+            const char *end         = name + name_length;
+            const char *p           = pattern;
+
+            for (; (*p != '\0') && (at != NULL); p++) {
+                const char *found = memchr (at, *p, end - at);
+
+                if (fold && (*p >= 'a') && (*p <= 'z')) {
+                    const char *upper = memchr (at, *p - ('a' - 'A'), ((found != NULL) ? found : end) - at);
+
+                    if (upper != NULL) found = upper;
+                }
+
+                at = (found != NULL) ? found + 1 : NULL;
+            }
+
+            if (at != NULL) {
+                indexes[n_batch] = i;
+                lengths[n_batch] = name_length;
+                length           = MAX (length, name_length);
+                n_batch++;
+            }
+        }
+
+        if ((n_batch < fuzzy_lanes) && ((i + 1 < n_names) || (n_batch == 0))) continue;
+
+        size_t size = (size_t) length * fuzzy_lanes;
+
+        /* grows at most to fuzzy_max_length * fuzzy_lanes - left to the arena */
+        if (size > chars_size) {
+            chars_size = MAX (size, MIN (2 * chars_size, (size_t) fuzzy_max_length * fuzzy_lanes));
+            chars      = (guint8 *) arena_alloc (arena, chars_size);
+
+            /* no memory: the names left are not matched */
+            if (chars == NULL) {
+                for (guint rest = i + 1; rest < n_names; rest++) scores[rest] = fuzzy_no_match;
+                return;
+            }
+        }
+
+        /* characters beyond a name and unused lanes are 0 - never matched */
+        memset (chars, 0, size);
+
+        for (int lane = 0; lane < n_batch; lane++) {
+            const char *name = names[indexes[lane]] + skip;
+
+            for (int pos = 0; pos < lengths[lane]; pos++) {
+                chars[pos * fuzzy_lanes + lane] = name[pos];
+            }
+        }
+
+        fuzzy_score_batch (chars, length, pattern, fold, batch_scores);
+
+        for (int lane = 0; lane < n_batch; lane++) {
+            scores[indexes[lane]] = batch_scores[lane];
+        }
+
+        n_batch = 0;
+        length  = 0;
+    }
+}
+
+#if defined(__SSE2__)
+
+/* score fuzzy_lanes names given as characters by position - like local sequence alignment per pattern
+ * character: score of matching it at the position and best score of matching it up to the position
+ * (reduced by gaps); the lanes of a vector are the names, scores saturate at G_MININT16 */
+static void fuzzy_score_batch (const guint8 *chars, int length, const char *pattern, bool fold, gint16 *scores)
+{
+    int m = strlen (pattern);
+
+    __m128i pattern_chars [m];
+    __m128i at            [m];  /* pattern up to j matched, j at the position */
+    __m128i upto          [m];  /* pattern up to j matched at the position or before */
+
+    const __m128i no_score = _mm_set1_epi16 (G_MININT16);
+    const __m128i no_match = _mm_set1_epi16 (fuzzy_no_match);
+
+    for (int j = 0; j < m; j++) {
+        pattern_chars[j] = _mm_set1_epi16 ((unsigned char) pattern[j]);
+        at[j]            = no_score;
+        upto[j]          = no_score;
+    }
+
+    __m128i best  = no_score;
+    __m128i prev  = _mm_set1_epi16 ('/');     /* start of name is a boundary */
+    int     reach = 1;                          /* pattern characters matched by now in any lane, + 1 */
+
+    for (int pos = 0; pos < length; pos++) {
+        __m128i c      = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (chars + pos * fuzzy_lanes)), _mm_setzero_si128 ());
+        __m128i upper  = _mm_and_si128 (_mm_cmpgt_epi16 (c, _mm_set1_epi16 ('A' - 1)), _mm_cmplt_epi16 (c, _mm_set1_epi16 ('Z' + 1)));
+        __m128i folded = fold ? _mm_add_epi16 (c, _mm_and_si128 (upper, _mm_set1_epi16 ('a' - 'A'))) : c;
+
+        /* most positions match no pattern character in any lane: only the gaps grow */
+        __m128i any_matched = _mm_setzero_si128 ();
+
+        for (int j = 0; j < reach; j++) {
+            any_matched = _mm_or_si128 (any_matched, _mm_cmpeq_epi16 (folded, pattern_chars[j]));
+        }
+
+        if (_mm_movemask_epi8 (any_matched) == 0) {
+            for (int j = 0; j < reach; j++) {
+                at[j]   = no_score;
+                upto[j] = _mm_subs_epi16 (upto[j], _mm_set1_epi16 (fuzzy_score_gap));
+            }
+
+            prev = c;
+            continue;
+        }
+
+        __m128i prev_lower = _mm_and_si128 (_mm_cmpgt_epi16 (prev, _mm_set1_epi16 ('a' - 1)), _mm_cmplt_epi16 (prev, _mm_set1_epi16 ('z' + 1)));
+
+        __m128i boundary = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi16 (prev, _mm_set1_epi16 (':')), _mm_cmpeq_epi16 (prev, _mm_set1_epi16 ('_'))),
+                                         _mm_or_si128 (_mm_cmpeq_epi16 (prev, _mm_set1_epi16 ('-')), _mm_cmpeq_epi16 (prev, _mm_set1_epi16 ('/'))));
+        boundary = _mm_or_si128 (boundary, _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi16 (prev, _mm_set1_epi16 ('.')), _mm_cmpeq_epi16 (prev, _mm_set1_epi16 (' '))),
+                                                         _mm_cmpeq_epi16 (prev, _mm_set1_epi16 ('('))));
+
+        /* a separator isn't lowercase: the bonuses exclude each other */
+        __m128i gain = _mm_or_si128 (_mm_and_si128 (boundary, _mm_set1_epi16 (fuzzy_bonus_boundary)),
+                                     _mm_and_si128 (_mm_and_si128 (prev_lower, upper), _mm_set1_epi16 (fuzzy_bonus_camel)));
+        gain = _mm_add_epi16 (gain, _mm_set1_epi16 (fuzzy_score_match));
+
+        prev = c;
+
+        /* backwards: j - 1 still holds the previous position */
+        for (int j = reach - 1; j >= 0; j--) {
+            __m128i from = (j == 0) ? _mm_setzero_si128 ()
+                                    : _mm_max_epi16 (upto[j - 1], _mm_adds_epi16 (at[j - 1], _mm_set1_epi16 (fuzzy_bonus_consecutive)));
+
+            __m128i matched = _mm_cmpeq_epi16 (folded, pattern_chars[j]);
+
+            at[j]   = _mm_or_si128 (_mm_and_si128 (matched, _mm_adds_epi16 (from, gain)), _mm_andnot_si128 (matched, no_score));
+            upto[j] = _mm_max_epi16 (_mm_subs_epi16 (upto[j], _mm_set1_epi16 (fuzzy_score_gap)), at[j]);
+        }
+
+        if (reach == m) {
+            best = _mm_max_epi16 (best, at[m - 1]);
+        } else if (_mm_movemask_epi8 (_mm_cmpgt_epi16 (upto[reach - 1], no_match)) != 0) {
+            reach++;
+        }
+    }
+
+    _mm_storeu_si128 ((__m128i *) scores, best);
+}
+
+#else
+
+/* scalar version of fuzzy_score_batch - same scores */
+static void fuzzy_score_batch (const guint8 *chars, int length, const char *pattern, bool fold, gint16 *scores)
+{
+    int m = strlen (pattern);
+
+    int at   [m];
+    int upto [m];
+
+    for (int lane = 0; lane < fuzzy_lanes; lane++) {
+        for (int j = 0; j < m; j++) {
+            at[j]   = G_MININT16;
+            upto[j] = G_MININT16;
+        }
+
+        int     best = G_MININT16;
+        guint8  prev = '/';
+
+        for (int pos = 0; pos < length; pos++) {
+            guint8  c = chars[pos * fuzzy_lanes + lane];
+
+            bool upper    = (c >= 'A') && (c <= 'Z');
+            bool boundary = (prev == ':') || (prev == '_') || (prev == '-') || (prev == '/') || (prev == '.') || (prev == ' ') || (prev == '(');
+            int  gain     = fuzzy_score_match;
+
+            if (boundary) {
+                gain += fuzzy_bonus_boundary;
+            } else if (upper && (prev >= 'a') && (prev <= 'z')) {
+                gain += fuzzy_bonus_camel;
+            }
+
+            prev = c;
+
+            if (fold && upper) c += 'a' - 'A';
+
+            for (int j = m - 1; j >= 0; j--) {
+                int from = (j == 0) ? 0 : MAX (upto[j - 1], at[j - 1] + fuzzy_bonus_consecutive);
+
+                at[j]   = (c == (unsigned char) pattern[j]) ? MAX (from + gain, G_MININT16) : G_MININT16;
+                upto[j] = MAX (MAX (upto[j] - fuzzy_score_gap, G_MININT16), at[j]);
+            }
+
+            best = MAX (best, at[m - 1]);
+        }
+
+        scores[lane] = MIN (best, G_MAXINT16);
+    }
+}
+
+#endif
+
+/*************************************************
+ * directory cache
+ *************************************************/
+
+/* listing of directory (NULL if it can't be read or isn't cached)
+ * returns: false if listing is outdated or missing - see directory_scan_start */
+static bool directory_cache_lookup (struct tclln_data *tclln, const char *path, struct directory_listing **listing)
+{
+    *listing = NULL;
+
+    if (tclln->directory_cache == NULL) return false;
+
+    struct directory_listing *cached = (struct directory_listing *) g_hash_table_lookup (tclln->directory_cache, path);
+
+    struct stat dir_stat;
+
+    if (stat (path, &dir_stat) != 0) {
+        if (cached != NULL) {
+            directory_cache_remove (tclln, cached);
+        }
+        return true;
+    }
+
+    if (cached == NULL) return false;
+
+    g_queue_unlink (&tclln->directory_lru, cached->lru_link);
+    g_queue_push_head_link (&tclln->directory_lru, cached->lru_link);
+
+    *listing = cached;
+
+    return directory_listing_valid (cached, &dir_stat);
+}
+
+/* add listing, replacing the one of the same directory - least recently used listings are dropped
+ * beyond directory_cache_max_size */
+static void directory_cache_insert (struct tclln_data *tclln, struct directory_listing *listing)
+{
+    if (tclln->directory_cache == NULL) {
+        tclln->directory_cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, directory_listing_free);
+    }
+
+    struct directory_listing *replaced = (struct directory_listing *) g_hash_table_lookup (tclln->directory_cache, listing->path);
+
+    if (replaced != NULL) {
+        directory_cache_remove (tclln, replaced);
+    }
+
+    g_hash_table_insert (tclln->directory_cache, listing->path, listing);
+    g_queue_push_head (&tclln->directory_lru, listing);
+    listing->lru_link = tclln->directory_lru.head;
+
+    tclln->directory_cache_bytes += listing->bytes;
+
+    /* the new listing is kept even if it exceeds the limit alone */
+    while ((tclln->directory_cache_bytes > directory_cache_max_size) && (g_queue_peek_tail (&tclln->directory_lru) != listing)) {
+        directory_cache_remove (tclln, (struct directory_listing *) g_queue_peek_tail (&tclln->directory_lru));
+    }
+}
+
+/* read directory by a thread - nothing if it is read already */
+static void directory_scan_start (struct tclln_data *tclln, const char *path)
+{
+    if (directory_scan_find (tclln, path) != NULL) return;
+
+    struct directory_scan *scan = (struct directory_scan *) alloc_malloc (sizeof (struct directory_scan));
+
+    scan->path    = g_strdup (path);
+    scan->listing = NULL;
+    scan->done    = false;
+    scan->tclln   = tclln;
+    scan->thread  = g_thread_try_new ("tclln_directory", directory_scan_thread, scan, NULL);
+
+    if (scan->thread == NULL) {
+        /* read here */
+        scan->listing = directory_list (path);
+        scan->done    = true;
+    }
+
+    g_ptr_array_add (tclln->directory_scans, scan);
+}
+
+static struct directory_scan *directory_scan_find (struct tclln_data *tclln, const char *path)
+{
+    for (guint i = 0; i < tclln->directory_scans->len; i++) {
+        struct directory_scan *scan = (struct directory_scan *) g_ptr_array_index (tclln->directory_scans, i);
+
+        if (strcmp (scan->path, path) == 0) return scan;
+    }
+
+    return NULL;
+}
+
+static gpointer directory_scan_thread (gpointer data)
+{
+    struct directory_scan *scan = (struct directory_scan *) data;
+
+    struct directory_listing *listing = directory_list (scan->path);
+
+    g_mutex_lock (&scan->tclln->directory_scan_mutex);
+    scan->listing = listing;
+    scan->done    = true;
+    g_cond_broadcast (&scan->tclln->directory_scan_cond);
+    g_mutex_unlock (&scan->tclln->directory_scan_mutex);
+
+    return NULL;
+}
+
+/* wait for directory read by a thread until deadline (0: no limit)
+ * returns: its listing, now cached - NULL if there is no scan, it isn't done or the directory can't be read */
+static struct directory_listing *directory_scan_wait (struct tclln_data *tclln, const char *path, gint64 deadline)
+{
+    struct directory_scan *scan = directory_scan_find (tclln, path);
+
+    if (scan == NULL) return NULL;
+
+    g_mutex_lock (&tclln->directory_scan_mutex);
+
+    while (!scan->done) {
+        if (deadline == 0) {
+            g_cond_wait (&tclln->directory_scan_cond, &tclln->directory_scan_mutex);
+        } else if (!g_cond_wait_until (&tclln->directory_scan_cond, &tclln->directory_scan_mutex, deadline)) {
+            break;
+        }
+    }
+
+    bool done = scan->done;
+
+    g_mutex_unlock (&tclln->directory_scan_mutex);
+
+    if (!done) return NULL;
+
+    return directory_scan_collect (tclln, scan);
+}
+
+/* move listing of finished scan to the cache
+ * returns: the listing - NULL if the directory can't be read */
+static struct directory_listing *directory_scan_collect (struct tclln_data *tclln, struct directory_scan *scan)
+{
+    struct directory_listing *listing = scan->listing;
+
+    if (scan->thread != NULL) {
+        g_thread_join (scan->thread);
+    }
+
+    if (listing != NULL) {
+        directory_cache_insert (tclln, listing);
+    }
+
+    g_ptr_array_remove_fast (tclln->directory_scans, scan);
+
+    g_free (scan->path);
+    alloc_free (scan);
+
+    return listing;
+}
+
+/* collect all finished scans */
+static void directory_scans_collect (struct tclln_data *tclln)
+{
+    for (guint i = tclln->directory_scans->len; i > 0; i--) {
+        struct directory_scan *scan = (struct directory_scan *) g_ptr_array_index (tclln->directory_scans, i - 1);
+
+        g_mutex_lock (&tclln->directory_scan_mutex);
+        bool done = scan->done;
+        g_mutex_unlock (&tclln->directory_scan_mutex);
+
+        if (done) {
+            directory_scan_collect (tclln, scan);
+        }
+    }
+}
+
+/* wait for all scans, drop their listings */
+static void directory_scans_free (struct tclln_data *tclln)
+{
+    if (tclln->directory_scans == NULL) return;
+
+    for (guint i = 0; i < tclln->directory_scans->len; i++) {
+        struct directory_scan *scan = (struct directory_scan *) g_ptr_array_index (tclln->directory_scans, i);
+
+        if (scan->thread != NULL) {
+            g_thread_join (scan->thread);
+        }
+        if (scan->listing != NULL) {
+            directory_listing_free (scan->listing);
+        }
+
+        g_free (scan->path);
+        alloc_free (scan);
+    }
+
+    g_ptr_array_free (tclln->directory_scans, true);
+    tclln->directory_scans = NULL;
+}
+
+/* read directory
+ * returns: NULL if it can't be opened */
+static struct directory_listing *directory_list (const char *path)
+{
+    DIR *dir = opendir (path);
+    if (dir == NULL) return NULL;
+
+    struct directory_listing *listing = (struct directory_listing *) alloc_malloc (sizeof (struct directory_listing));
+
+    listing->path     = g_strdup (path);
+    listing->names    = g_ptr_array_new ();
+    listing->strings  = g_string_chunk_new (4096);
+    listing->bytes    = sizeof (struct directory_listing) + strlen (path) + 1;
+    listing->lru_link = NULL;
+
+    clock_gettime (CLOCK_REALTIME, &listing->listed);
+
+    /* before reading: changes while reading are seen by the next validation */
+    struct stat dir_stat;
+
+    if (fstat (dirfd (dir), &dir_stat) == 0) {
+        listing->device = dir_stat.st_dev;
+        listing->inode  = dir_stat.st_ino;
+        listing->mtime  = dir_stat.st_mtim;
+    } else {
+        /* never valid */
+        listing->device = 0;
+        listing->inode  = 0;
+        listing->mtime  = listing->listed;
+    }
+
+    for (struct dirent *i_entry = readdir (dir); i_entry != NULL; i_entry = readdir (dir)) {
+        g_ptr_array_add (listing->names, g_string_chunk_insert (listing->strings, i_entry->d_name));
+
+        listing->bytes += sizeof (gpointer) + strlen (i_entry->d_name) + 1;
+    }
+
+    closedir (dir);
+
+    g_ptr_array_sort (listing->names, completion_compare);
+
+    return listing;
+}
+
+static bool directory_listing_valid (const struct directory_listing *listing, const struct stat *dir_stat)
+{
+    if (listing->device        != dir_stat->st_dev)          return false;
+    if (listing->inode         != dir_stat->st_ino)          return false;
+    if (listing->mtime.tv_sec  != dir_stat->st_mtim.tv_sec)  return false;
+    if (listing->mtime.tv_nsec != dir_stat->st_mtim.tv_nsec) return false;
+
+    /* modified just before it was listed: a later change may have kept the timestamp - file systems
+     * without sub-second timestamps get a coarser margin */
+    gint64 mtime_ns  = listing->mtime.tv_sec  * (gint64) 1000000000 + listing->mtime.tv_nsec;
+    gint64 listed_ns = listing->listed.tv_sec * (gint64) 1000000000 + listing->listed.tv_nsec;
+    gint64 margin_ns = (listing->mtime.tv_nsec == 0) ? directory_mtime_coarse_margin_ns : directory_mtime_margin_ns;
+
+    if (listed_ns - mtime_ns <= margin_ns) return false;
+
+    return true;
+}
+
+static void directory_cache_remove (struct tclln_data *tclln, struct directory_listing *listing)
+{
+    g_queue_delete_link (&tclln->directory_lru, listing->lru_link);
+
+    tclln->directory_cache_bytes -= listing->bytes;
+
+    g_hash_table_remove (tclln->directory_cache, listing->path);
+}
+
+static void directory_listing_free (gpointer data)
+{
+    struct directory_listing *listing = (struct directory_listing *) data;
+
+    g_ptr_array_free (listing->names, true);
+    g_string_chunk_free (listing->strings);
+    g_free (listing->path);
+    alloc_free (listing);
+}
+
+static void directory_cache_free (struct tclln_data *tclln)
+{
+    if (tclln->directory_cache != NULL) {
+        g_hash_table_destroy (tclln->directory_cache);
+        tclln->directory_cache = NULL;
+    }
+
+    g_queue_clear (&tclln->directory_lru);
+    tclln->directory_cache_bytes = 0;
+}
+
+/*************************************************
+ * completion indexes
+ *************************************************/
+
+static struct index_namespace *index_namespace_new (GHashTable *namespaces, GStringChunk *strings, const char *ns_name)
+{
+    struct index_namespace *ns = (struct index_namespace *) alloc_malloc (sizeof (struct index_namespace));
+
+    ns->name       = g_string_chunk_insert_const (strings, ns_name);
+    ns->names      = g_ptr_array_new ();
+    ns->generation = 0;
+    ns->stale      = false;
+
+    g_hash_table_insert (namespaces, ns->name, ns);
+
+    return ns;
+}
+
+static void index_namespace_free (gpointer data)
+{
+    struct index_namespace *ns = (struct index_namespace *) data;
+
+    g_ptr_array_free (ns->names, true);
+    alloc_free (ns);
+}
+
+/* namespace was deleted - not found by command_index_scan */
+static gboolean index_namespace_unseen (gpointer key, gpointer value, gpointer data)
+{
+    return !g_hash_table_contains ((GHashTable *) data, key);
+}
+
+static void index_namespace_mark_stale (gpointer key, gpointer value, gpointer data)
+{
+    ((struct index_namespace *) value)->stale = true;
+}
+
+/* evaluate command given as words in the global namespace - interpreter result is kept
+ * returns: result of the command (to be released by caller) or NULL on error */
+static Tcl_Obj *index_eval (Tcl_Interp *interp, int objc, const char *const words[])
+{
+    Tcl_Obj *objv[3];   /* longest command of the indexes */
+
+    for (int i = 0; i < objc; i++) {
+        objv[i] = Tcl_NewStringObj (words[i], -1);
+        Tcl_IncrRefCount (objv[i]);
+    }
+
+    Tcl_InterpState state  = Tcl_SaveInterpState (interp, TCL_OK);
+    Tcl_Obj         *result = NULL;
+
+    if (Tcl_EvalObjv (interp, objc, objv, TCL_EVAL_GLOBAL) == TCL_OK) {
+        result = Tcl_GetObjResult (interp);
+        Tcl_IncrRefCount (result);
+    }
+
+    Tcl_RestoreInterpState (interp, state);
+
+    for (int i = 0; i < objc; i++) {
+        Tcl_DecrRefCount (objv[i]);
+    }
+
+    return result;
+}
+
+/* number of commands evaluated by the interpreter
+ * returns: -1 on error */
+static int index_epoch (Tcl_Interp *interp)
+{
+    static const char *const words[] = {"::info", "cmdcount"};
+
+    Tcl_Obj *result = index_eval (interp, 2, words);
+    int     epoch   = -1;
+
+    if (result != NULL) {
+        if (Tcl_GetIntFromObj (NULL, result, &epoch) != TCL_OK) {
+            epoch = -1;
+        }
+        Tcl_DecrRefCount (result);
+    }
+
+    return epoch;
+}
+
+/* generation of the interpreter state: advances if commands ran since the last call - commands of
+ * the indexes themselves are excluded by index_sync
+ * tcl has no notification of new commands or variables, so the indexes compare this epoch */
+static unsigned index_generation (struct tclln_data *tclln)
+{
+    int epoch = index_epoch (tclln->tcl_interp);
+
+    if (tclln->index_epoch_step == 0) {
+        /* first read: measure how much a read counts itself */
+        tclln->index_epoch      = index_epoch (tclln->tcl_interp);
+        tclln->index_epoch_step = tclln->index_epoch - epoch;
+        tclln->index_generation++;
+
+        return tclln->index_generation;
+    }
+
+    if ((epoch < 0) || ((unsigned) epoch - (unsigned) tclln->index_epoch != (unsigned) tclln->index_epoch_step)) {
+        tclln->index_generation++;
+    }
+
+    tclln->index_epoch = epoch;
+
+    return tclln->index_generation;
+}
 
-    /* for multi-line inputs */
-    GString *gs_input = g_string_new (NULL);
+/* commands of an index ran - not counted as change of the generation */
+static void index_sync (struct tclln_data *tclln)
+{
+    tclln->index_epoch = index_epoch (tclln->tcl_interp);
+}
 
-    char buf [FILE_BUF_LEN];
+/* name without namespace qualifiers */
+static const char *qualified_name_tail (const char *name)
+{
+    const char *tail = name;
 
-    while (true) {
-        if (tclln->exit_tcl) {
-            break;
+    for (const char *c = name; *c != '\0'; c++) {
+        if ((c[0] == ':') && (c[1] == ':')) {
+            tail = c + 2;
         }
+    }
 
-        /* try reading */
-        char *line = fgets (buf, FILE_BUF_LEN, infile);
+    return tail;
+}
 
-        if (line == NULL) {
-            /* EOF and nothing left to execute? -> finish */
-            if (gs_input->len == 0) break;
-        } else {
-            gs_input = g_string_append (gs_input, line);
+/* namespace of base - like info commands/vars, a qualified base selects the namespace, else the global
+ * namespace is searched
+ *   qualifier: set to the qualifier as typed (with trailing "::") - NULL if there is none
+ *   tail: set to base without qualifier
+ * returns: fully qualified name of namespace - NULL if out of memory */
+static const char *index_select_namespace (struct arena *arena, const char *base, const char **qualifier, const char **tail)
+{
+    *tail      = qualified_name_tail (base);
+    *qualifier = NULL;
 
-            /* line not yet finished? -> wait for more input */
-            if (gs_input->len == 0) continue;
+    if (*tail == base) return "::";
 
-            char end = gs_input->str[gs_input->len - 1];
-            if ((end != '\n') && (end != '\r')) continue;
-        }
+    *qualifier = arena_strdup (arena, base, *tail - base);
 
-        bool brace_match = (Tcl_CommandComplete (gs_input->str) == 1 ? true : false);
-        if (!brace_match) {
-            /* no complete tcl command? wait for more input */
-            continue;
-        }
+    const char *ns_path = arena_strdup (arena, base, *tail - base - 2);
 
-        /* verbose? print command: */
-        if (verbose) {
-            fprintf (stdout, "%s", gs_input->str);
-        }
+    if ((*qualifier == NULL) || (ns_path == NULL)) return NULL;
 
-        /* enough input for script execution: */
-        int tcl_res = Tcl_Eval (tclln->tcl_interp, gs_input->str);
+    if (*ns_path == '\0') return "::";
+    if ((ns_path[0] == ':') && (ns_path[1] == ':')) return ns_path;
 
-        if (verbose || (tcl_res != TCL_OK)) {
-            const char *result_string = Tcl_GetString (Tcl_GetObjResult (tclln->tcl_interp));
+    return arena_concat (arena, "::", ns_path);
+}
 
-            if (strlen (result_string) > 0) {
-                fprintf (stdout, "%s\n", result_string);
-            }
+/* first position of sorted names >= prefix - matches of prefix follow */
+static int index_find (GPtrArray *names, const char *prefix)
+{
+    int lower = 0;
+    int upper = names->len;
 
-            if (tcl_res != TCL_OK) {
-                break;
-            }
-        }
+    while (lower < upper) {
+        int middle = (lower + upper) / 2;
 
-        /* next input */
-        g_string_assign (gs_input, "");
+        if (strcmp (g_ptr_array_index (names, middle), prefix) < 0) {
+            lower = middle + 1;
+        } else {
+            upper = middle;
+        }
     }
 
-    fclose (infile);
-    g_string_free (gs_input, true);
-
-    return true;
+    return lower;
 }
 
-/*************************************************
- * custom commands
- *************************************************/
-
-Tcl_Command tclln_add_command (
-                struct tclln_data *tclln, const char *command_name, const char * const arg_complete_list[],
-                Tcl_ObjCmdProc *command_proc, ClientData client_data, Tcl_CmdDeleteProc *delete_proc)
+/* add sorted names starting with prefix as candidates, preceded by qualifier (or NULL)
+ * returns: number of names added - at most limit */
+static int index_add_matches (GPtrArray *names, const char *prefix, const char *qualifier, struct arena *arena, GPtrArray *candidates, int limit)
 {
-    Tcl_Command result = Tcl_CreateObjCommand (tclln->tcl_interp, command_name, command_proc, client_data, delete_proc);
+    int len   = strlen (prefix);
+    int added = 0;
 
-    if (arg_complete_list != NULL) {
-        completion_table_add_command (tclln, command_name, arg_complete_list);
+    for (guint i = index_find (names, prefix); (i < names->len) && (added < limit); i++, added++) {
+        const char *name = g_ptr_array_index (names, i);
+
+        if (strncmp (name, prefix, len) != 0) break;
+
+        g_ptr_array_add (candidates, (qualifier == NULL) ? (gpointer) name : arena_concat (arena, qualifier, name));
     }
 
-    return result;
+    return added;
 }
 
-/*************************************************
- * prompt string
- *************************************************/
-
-void tclln_set_prompt (struct tclln_data *tclln, const char *prompt_main, const char *prompt_multiline)
+/* adds bytes and number of names in namespaces (or NULL) */
+static void index_usage (GHashTable *namespaces, size_t *bytes, size_t *entries)
 {
-    if (prompt_main == NULL) {
-        tclln->prompt_string_main = default_prompt_main;
-    } else {
-        tclln->prompt_string_main = prompt_main;
-    }
+    if (namespaces == NULL) return;
 
-    if (prompt_multiline == NULL) {
-        tclln->prompt_string_multiline = default_prompt_multiline;
-    } else {
-        tclln->prompt_string_multiline = prompt_multiline;
-    }
-}
+    GHashTableIter iter;
+    gpointer       value;
 
-static const char *prompt (struct tclln_data *tclln) {
-    if (tclln == NULL) {
-        return default_prompt_main;
-    } else {
-        if (tclln->multiline) {
-            return tclln->prompt_string_multiline;
-        } else {
-            return tclln->prompt_string_main;
+    g_hash_table_iter_init (&iter, namespaces);
+
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        struct index_namespace *ns = (struct index_namespace *) value;
+
+        *bytes += sizeof (struct index_namespace) + strlen (ns->name) + 1;
+
+        for (guint i = 0; i < ns->names->len; i++) {
+            *bytes += sizeof (gpointer) + strlen (g_ptr_array_index (ns->names, i)) + 1;
         }
+
+        *entries += ns->names->len;
     }
 }
 
-
 /*************************************************
- * completion
+ * command index
  *************************************************/
 
-void tclln_provide_completion_command (struct tclln_data *tclln, const char *command_name)
+static void command_index_free (struct command_index *index)
 {
-    if (tclln == NULL) return;
-
-    if (command_name == NULL) command_name = "tclln::add_completion";
+    command_index_changed (index);
 
-    Tcl_CreateObjCommand (tclln->tcl_interp, command_name, tcl_completion_add_command, (ClientData) tclln, NULL);
+    if (index->namespaces != NULL) {
+        g_hash_table_destroy (index->namespaces);
+        index->namespaces = NULL;
+    }
+    if (index->strings != NULL) {
+        g_string_chunk_free (index->strings);
+        index->strings = NULL;
+    }
 }
 
-static int tcl_completion_add_command (ClientData client_data, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+/* names were added or removed - drops the qualified names */
+static void command_index_changed (struct command_index *index)
 {
-    if (objc < 3) {
-        Tcl_SetObjResult (interp, Tcl_NewStringObj ("wrong number of arguments: expeted at least command name and 1 possible argument", -1));
-        return TCL_ERROR;
+    if (index->qualified != NULL) {
+        g_ptr_array_free (index->qualified, true);
+        g_string_chunk_free (index->qualified_strings);
+        index->qualified         = NULL;
+        index->qualified_strings = NULL;
     }
+}
 
-    const char *command_name = Tcl_GetString (objv[1]);
+/* bring the index up to date - built on first use
+ * if any command ran since the last validation, the command counts of all namespaces are compared
+ * and only changed namespaces are listed again
+ * returns: false if there is no index */
+static bool command_index_validate (struct tclln_data *tclln)
+{
+    struct command_index *index = &tclln->command_index;
 
-    struct tclln_data *tclln = (struct tclln_data*) client_data;
-    if (tclln == NULL) {
-        return TCL_ERROR;
-    }
+    unsigned generation = index_generation (tclln);
 
-    const char **arg_list = (const char **) malloc (sizeof (const char *) * (objc-1));
-    if (arg_list == NULL) {
-        return TCL_ERROR;
-    }
+    if (index->namespaces == NULL) {
+        index->namespaces = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, index_namespace_free);
+        index->strings    = g_string_chunk_new (4096);
 
-    for (int i = 0; i < objc-2; i++) {
-        arg_list[i] = Tcl_GetString (objv[2+i]);
+        if ((index->namespaces == NULL) || (index->strings == NULL)) {
+            command_index_free (index);
+            return false;
+        }
+    } else if (generation == index->generation) {
+        /* nothing ran - deleted and renamed commands were removed by the traces */
+        return true;
     }
-    arg_list[objc-2] = NULL;
 
-    completion_table_add_command (tclln, command_name, arg_list);
+    GHashTable *seen = g_hash_table_new (g_str_hash, g_str_equal);
 
-    free (arg_list);
+    command_index_scan (tclln, "::", seen);
+    if (g_hash_table_foreach_remove (index->namespaces, index_namespace_unseen, seen) > 0) {
+        command_index_changed (index);
+    }
 
-    Tcl_SetObjResult (interp, Tcl_NewBooleanObj (true));
+    g_hash_table_destroy (seen);
 
-    return TCL_OK;
+    index_sync (tclln);
+    index->generation = generation;
+
+    return true;
 }
 
-static void completion_table_add_command (struct tclln_data *tclln, const char *command, const char *const arg_complete_list[])
+/* compare command count of namespace and its children with the index - namespaces are added to seen */
+static void command_index_scan (struct tclln_data *tclln, const char *ns_name, GHashTable *seen)
 {
-    GList *arg_list = NULL;
+    struct command_index *index  = &tclln->command_index;
+    Tcl_Interp           *interp = tclln->tcl_interp;
+
+    struct index_namespace *ns = (struct index_namespace *) g_hash_table_lookup (index->namespaces, ns_name);
 
-    for (int i = 0; arg_complete_list[i] != NULL; i++) {
-        arg_list = g_list_prepend (arg_list, g_string_chunk_insert_const (tclln->completion_arg_strings, arg_complete_list[i]));
+    if (ns == NULL) {
+        ns = index_namespace_new (index->namespaces, index->strings, ns_name);
     }
 
-    arg_list = g_list_sort (arg_list, (GCompareFunc) strcmp);
+    g_hash_table_add (seen, ns->name);
 
-    char *key = g_string_chunk_insert_const (tclln->completion_arg_strings, command);
-    GList *old_list = (GList *) g_tree_lookup (tclln->completion_arg_table, key);
+    /* commands */
+    char *pattern = g_strdup_printf ("%s::*", (strcmp (ns_name, "::") == 0) ? "" : ns_name);
+
+    const char *const list_words[] = {"::info", "commands", pattern};
+    Tcl_Obj *list = index_eval (interp, 3, list_words);
+
+    g_free (pattern);
+
+    if (list != NULL) {
+        int n_commands;
 
-    g_tree_insert (tclln->completion_arg_table, key, arg_list);
+        if (Tcl_ListObjLength (NULL, list, &n_commands) == TCL_OK) {
+            if (n_commands != (int) ns->names->len) {
+                command_index_fill (tclln, ns, list);
+            }
+        }
 
-    if (old_list != NULL) {
-        g_list_free (old_list);
+        Tcl_DecrRefCount (list);
     }
-}
 
-static void completion_table_add_defaults (struct tclln_data *tclln)
-{
-    completion_table_add_command (tclln, "after",
-        (const char * const []) {"cancel", "idle", "info", NULL});
+    /* child namespaces */
+    const char *const children_words[] = {"::namespace", "children", ns_name};
+    Tcl_Obj *children = index_eval (interp, 3, children_words);
+
+    if (children == NULL) return;
 
-    completion_table_add_command (tclln, "array",
-        (const char * const []) {"anymore", "donesearch", "exists", "get", "names", "nextelement", "set", "size",
-            "startsearch", "statistics", "unset", NULL});
+    int     n_children;
+    Tcl_Obj **child_objs;
 
-    completion_table_add_command (tclln, "binary",
-        (const char * const []) {"decode", "encode", "format", "scan", "base64", "hex", "uuencode", "-maxlen",
-            "-wrapchar", "-strict", NULL});
+    if (Tcl_ListObjGetElements (NULL, children, &n_children, &child_objs) == TCL_OK) {
+        for (int i = 0; i < n_children; i++) {
+            command_index_scan (tclln, Tcl_GetString (child_objs[i]), seen);
+        }
+    }
 
-    completion_table_add_command (tclln, "chan",
-        (const char * const []) {"blocked", "close", "configure", "copy", "create", "current", "end", "eof", "event",
-            "flush", "gets", "names", "pending", "pipe", "pop", "postevent", "push", "puts", "read", "seek", "start",
-            "tell", "truncate", "-blocking", "-buffering", "-buffersize", "-encoding", "-eofchar", "-eofchar", "-nonewline",
-            "-translation", NULL});
+    Tcl_DecrRefCount (children);
+}
 
-    completion_table_add_command (tclln, "chan",
-        (const char * const []) {"add", "clicks", "format", "microseconds", "milliseconds", "scan", "seconds", "-base",
-        "-format", "-gmt", "-locale", "-timezone", NULL});
+/* replace commands of namespace by list of fully qualified names - new commands get a trace */
+static void command_index_fill (struct tclln_data *tclln, struct index_namespace *ns, Tcl_Obj *list)
+{
+    int     n_commands;
+    Tcl_Obj **command_objs;
 
-    completion_table_add_command (tclln, "dict",
-        (const char * const []) {"append", "create", "exists", "filter", "key", "script", "value", "for", "get", "incr",
-            "info", "keys", "lappend", "map", "merge", "remove", "replace", "set", "size", "unset", "update", "values",
-            "with", NULL});
+    if (Tcl_ListObjGetElements (NULL, list, &n_commands, &command_objs) != TCL_OK) return;
 
-    completion_table_add_command (tclln, "encoding",
-        (const char * const []) {"convertfrom", "convertto", "dirs", "names", "system", NULL});
+    g_ptr_array_set_size (ns->names, 0);
+    command_index_changed (&tclln->command_index);
 
-    completion_table_add_command (tclln, "fconfigure",
-        (const char * const []) {"-blocking", "-buffering", "-buffersize", "-encoding", "-eofchar", "-eofchar", "-translation",
-        "-translation", NULL});
+    for (int i = 0; i < n_commands; i++) {
+        const char *full_name = Tcl_GetString (command_objs[i]);
 
-    completion_table_add_command (tclln, "fcopy",
-        (const char * const []) {"-size", "-command", NULL});
+        g_ptr_array_add (ns->names, g_string_chunk_insert_const (tclln->command_index.strings, qualified_name_tail (full_name)));
 
-    completion_table_add_command (tclln, "file",
-        (const char * const []) {"atime", "attributes", "channels", "copy", "-force", "dirname", "executable", "exists",
-            "extension", "isdirectory", "isfile", "join", "link", "lstat", "mkdir", "mtime", "nativename", "normalize",
-            "owned", "pathtype", "readable", "readlink", "rename", "rootname", "separator", "size", "split", "stat",
-            "system", "tail", "tempfile", "type", "volumes", "writable", NULL});
+        /* traces stay with renamed commands and a dropped index */
+        if (Tcl_CommandTraceInfo (tclln->tcl_interp, full_name, 0, command_index_trace, NULL) == NULL) {
+            Tcl_TraceCommand (tclln->tcl_interp, full_name, TCL_TRACE_RENAME | TCL_TRACE_DELETE, command_index_trace, (ClientData) tclln);
+        }
+    }
 
-    completion_table_add_command (tclln, "fileevent",
-        (const char * const []) {"readable", "writeable", NULL});
+    g_ptr_array_sort (ns->names, completion_compare);
+}
 
-    completion_table_add_command (tclln, "glob",
-        (const char * const []) {"-directory", "-join", "-nocomplain", "-path", "-tails", "-types", NULL});
+/* indexed command renamed or deleted: remove old name - a new name is found by the next validation,
+ * as renaming runs a command */
+static void command_index_trace (ClientData client_data, Tcl_Interp *interp, const char *old_name, const char *new_name, int flags)
+{
+    struct tclln_data    *tclln = (struct tclln_data *) client_data;
+    struct command_index *index = &tclln->command_index;
 
-    completion_table_add_command (tclln, "history",
-        (const char * const []) {"add", "change", "clear", "event", "info", "keep", "nextid", "redo", NULL});
+    if ((flags & TCL_INTERP_DESTROYED) || (index->namespaces == NULL) || (old_name == NULL)) return;
 
-    completion_table_add_command (tclln, "info",
-        (const char * const []) {"args", "body", "class", "cmdcount", "commands", "complete", "coroutine", "default",
-            "errorstack", "exists", "frame", "function", "globals", "hostname", "level", "library", "loaded",
-            "locals", "nameofexecutable", "object", "patchlevel", "procs", "script", "sharedlibextension",
-            "tclversion", "vars", NULL});
+    /* old name is fully qualified */
+    const char *tail    = qualified_name_tail (old_name);
+    char       *ns_name = (tail - old_name > 2) ? g_strndup (old_name, tail - old_name - 2) : g_strdup ("::");
 
-    completion_table_add_command (tclln, "interp",
-        (const char * const []) { "alias", "aliases", "bgerror", "cancel", "create", "debug", "delete", "eval",
-            "exists", "expose", "hide", "hidden", "invokehidden", "issafe", "limit", "marktrusted", "recursionlimit",
-            "share", "slaves", "target", "transfer", NULL});
+    struct index_namespace *ns = (struct index_namespace *) g_hash_table_lookup (index->namespaces, ns_name);
 
-    completion_table_add_command (tclln, "load",
-        (const char * const []) {"-global", "-lazy", NULL});
+    g_free (ns_name);
 
-    completion_table_add_command (tclln, "lsearch",
-        (const char * const []) {"-exact", "-glob", "-regexp", "-sorted", "-all", "-inline", "-not", "-start",
-            "-ascii", "-dictionary", "-integer", "-nocase", "-real", "-decreasing", "-increasing", "-bisect",
-            "-index", "-subindices", NULL});
+    if (ns == NULL) return;
 
-    completion_table_add_command (tclln, "lsort",
-        (const char * const []) {"-ascii", "-dictionary", "-integer", "-real", "-command", "-increasing", "-decreasing",
-            "-indices", "-index", "-stride", "-nocase", "-unique", NULL});
+    int pos = index_find (ns->names, tail);
 
-    completion_table_add_command (tclln, "namespace",
-        (const char * const []) {"children", "code", "current", "delete", "ensemble", "eval", "exists", "export", "-clear",
-            "forget", "import", "-force", "inscope", "origin", "parent", "path", "qualifiers", "tail", "upvar", "unknown",
-            "which", "-command", "-variable", NULL});
+    if ((pos < (int) ns->names->len) && (strcmp (g_ptr_array_index (ns->names, pos), tail) == 0)) {
+        g_ptr_array_remove_index (ns->names, pos);
+        command_index_changed (index);
+    }
+}
 
-    completion_table_add_command (tclln, "package",
-        (const char * const []) {"forget", "ifneeded", "names", "present", "provide", "require", "unknown", "vcompare",
-            "versions", "vsatisfies", "prefer", NULL});
+/* commands starting with base - candidates keep the qualifier as typed */
+static void command_index_lookup (struct command_index *index, struct arena *arena, GPtrArray *candidates, const char *base)
+{
+    const char *qualifier;
+    const char *tail;
+    const char *ns_name = index_select_namespace (arena, base, &qualifier, &tail);
 
-    completion_table_add_command (tclln, "puts",
-        (const char * const []) {"-nonewline",  NULL});
+    if (ns_name == NULL) return;
 
-    completion_table_add_command (tclln, "read",
-        (const char * const []) {"-nonewline",  NULL});
+    struct index_namespace *ns = (struct index_namespace *) g_hash_table_lookup (index->namespaces, ns_name);
 
-    completion_table_add_command (tclln, "regexp",
-        (const char * const []) {"-about", "-expanded", "-indices", "-line", "-linestop", "-lineanchor", "-nocase",
-            "-all", "-inline", "-start", NULL});
+    if (ns == NULL) return;
 
-    completion_table_add_command (tclln, "regsub",
-        (const char * const []) {"-all", "-expanded", "-line", "-linestop", "-lineanchor", "-nocase", "-start", NULL});
+    index_add_matches (ns->names, tail, qualifier, arena, candidates, G_MAXINT);
+}
 
-    completion_table_add_command (tclln, "return",
-        (const char * const []) {"ok", "error", "return", "break", "continue", "-code", "-errorcode", "-errorinfo",
-            "-errorstack", "-level", "-options", NULL});
+/* commands of all namespaces for fuzzy completion - qualified relative to the global namespace, fully
+ * qualified if base is; the qualified names are kept until the index changes */
+static void command_index_all (struct command_index *index, GPtrArray *candidates, const char *base)
+{
+    bool absolute = (base[0] == ':') && (base[1] == ':');
 
-    completion_table_add_command (tclln, "seek",
-        (const char * const []) {"start", "current", "end", NULL});
+    if (index->qualified == NULL) {
+        index->qualified         = g_ptr_array_new ();
+        index->qualified_strings = g_string_chunk_new (64 * 1024);
 
-    completion_table_add_command (tclln, "self",
-        (const char * const []) {"call", "caller", "class", "filter", "method", "namespace", "next", "object",
-            "target", NULL});
+        GHashTableIter iter;
+        gpointer       value;
+        GString        *name = g_string_new (NULL);
 
-    completion_table_add_command (tclln, "socket",
-        (const char * const []) {"-async", "-connecting", "-error", "-myaddr", "-myport", "-peername", "-server",
-            "-sockname", NULL});
+        g_hash_table_iter_init (&iter, index->namespaces);
 
-    completion_table_add_command (tclln, "source",
-        (const char * const []) {"-encoding", NULL});
+        while (g_hash_table_iter_next (&iter, NULL, &value)) {
+            struct index_namespace *ns = (struct index_namespace *) value;
 
-    completion_table_add_command (tclln, "string",
-        (const char * const []) { "-failindex", "-length", "-nocase", "-strict", "alnum", "alpha", "ascii", "boolean",
-            "cat", "compare", "control", "digit", "double", "entier", "equal", "false", "first", "graph", "index",
-            "integer", "is", "last", "length", "list", "lower", "map", "match", "print", "punct", "range", "repeat",
-            "replace", "reverse", "space", "tolower", "totitle", "toupper", "trim", "trimleft", "trimright", "true",
-            "upper", "wideinteger", "wordchar", "xdigit", NULL});
+            g_string_assign (name, (strcmp (ns->name, "::") == 0) ? "" : ns->name);
+            g_string_append (name, "::");
 
-    completion_table_add_command (tclln, "subst",
-        (const char * const []) {"-nobackslashes", "-nocommands", "-novariables", NULL});
+            gsize qualifier_len = name->len;
 
-    completion_table_add_command (tclln, "switch",
-        (const char * const []) {"-exact", "-glob", "-regexp", "-nocase", "-matchvar", "-indexvar", NULL});
+            for (guint i = 0; i < ns->names->len; i++) {
+                g_string_truncate (name, qualifier_len);
+                g_string_append (name, g_ptr_array_index (ns->names, i));
 
-    completion_table_add_command (tclln, "trace",
-        (const char * const []) {"add", "array", "command", "delete", "enter", "enterstep", "execution", "info",
-            "leave", "leavestep", "read", "remove", "rename", "unset", "variable", "vdelete", "vinfo", "write", NULL});
+                g_ptr_array_add (index->qualified, g_string_chunk_insert_len (index->qualified_strings, name->str, name->len));
+            }
+        }
 
-    completion_table_add_command (tclln, "unload",
-        (const char * const []) {"-nocomplain", "-keeplibrary", NULL});
+        g_string_free (name, true);
+    }
 
-    completion_table_add_command (tclln, "unset",
-        (const char * const []) {"-nocomplain", NULL});
+    /* relative: without the leading "::" */
+    for (guint i = 0; i < index->qualified->len; i++) {
+        const char *name = g_ptr_array_index (index->qualified, i);
 
-    completion_table_add_command (tclln, "update",
-        (const char * const []) {"idletasks", NULL});
+        g_ptr_array_add (candidates, (gpointer) (absolute ? name : name + 2));
+    }
 }
 
+/*************************************************
+ * variable index
+ *************************************************/
 
-static void completion (const char *input_buffer, linenoiseCompletions *linenoise_completion)
+/* drops the index - traces of arrays are removed (unless the interpreter is gone) */
+static void variable_index_free (struct tclln_data *tclln)
 {
-    struct tclln_data *tclln = tclln_completion;
+    struct variable_index *index = &tclln->variable_index;
 
-    if (tclln == NULL) return;
+    if (index->arrays != NULL) {
+        if (tclln->tcl_interp != NULL) {
+            GHashTableIter iter;
+            gpointer       value;
 
-    /* empty line? */
-    if (strcmp (input_buffer, "") == 0) return;
+            g_hash_table_iter_init (&iter, index->arrays);
 
-    tclln->completion_begin = g_string_assign (tclln->completion_begin, input_buffer);
+            while (g_hash_table_iter_next (&iter, NULL, &value)) {
+                struct variable_array *array = (struct variable_array *) value;
 
-    /* generate completion data */
-    completion_generate (tclln);
-    tclln->completion_list = g_list_sort (tclln->completion_list, (GCompareFunc) strcmp);
+                Tcl_UntraceVar2 (tclln->tcl_interp, array->name, NULL, TCL_GLOBAL_ONLY | TCL_TRACE_WRITES | TCL_TRACE_UNSETS,
+                                 variable_array_trace, (ClientData) array);
+            }
+        }
 
-    if (tclln->completion_list == NULL) {
-        return;
+        g_hash_table_destroy (index->arrays);
+        index->arrays = NULL;
+    }
+    if (index->namespaces != NULL) {
+        g_hash_table_destroy (index->namespaces);
+        index->namespaces = NULL;
+    }
+    if (index->strings != NULL) {
+        g_string_chunk_free (index->strings);
+        index->strings = NULL;
     }
+}
 
-    /* fill completion */
-    GList *completion_list = tclln->completion_list;
+/* built on first use
+ * returns: false if out of memory */
+static bool variable_index_create (struct tclln_data *tclln)
+{
+    struct variable_index *index = &tclln->variable_index;
 
-    GString *temp_str = g_string_new (NULL);
+    if (index->namespaces != NULL) return true;
 
-    while (completion_list != NULL) {
-        g_string_assign (temp_str, tclln->completion_begin->str);
-        g_string_append (temp_str, completion_list->data);
-        linenoiseAddCompletion (linenoise_completion, temp_str->str);
-        completion_list = completion_list->next;
-    }
+    index->namespaces = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, index_namespace_free);
+    index->arrays     = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, variable_array_free);
+    index->strings    = g_string_chunk_new (4096);
 
-    g_string_free (temp_str, true);
+    if ((index->namespaces == NULL) || (index->arrays == NULL) || (index->strings == NULL)) {
+        variable_index_free (tclln);
+        return false;
+    }
 
-    return;
+    return true;
 }
 
-static void completion_generate (struct tclln_data *tclln)
+/* variables of namespace - listed again if the generation changed and their count differs or a
+ * variable was unset
+ * returns: NULL if there is no index */
+static struct index_namespace *variable_index_namespace (struct tclln_data *tclln, const char *ns_name)
 {
-    /* init */
-    if (tclln->completion_list != NULL) {
-        g_list_free (tclln->completion_list);
-        tclln->completion_list = NULL;
-    }
-
-    g_string_chunk_clear (tclln->completion_strings);
+    struct variable_index *index = &tclln->variable_index;
 
-    /* find out what to complete */
-    int pos_cmd = 0;
-    int len_cmd = 0;
-    int pos_start = strlen (tclln->completion_begin->str);
+    if (!variable_index_create (tclln)) return NULL;
 
-    char *str_cmd;
-    char *str_base;
+    unsigned generation = index_generation (tclln);
 
-    const char *in_buf = tclln->completion_begin->str;
+    struct index_namespace *ns = (struct index_namespace *) g_hash_table_lookup (index->namespaces, ns_name);
 
-    /* find beginning of relevant section */
-    int brace_count = 0;
-    int pos_tmp = tclln->completion_begin->len - 1;
-    while (pos_tmp >= 0) {
-        char current = in_buf[pos_tmp];
-        if (current == ']') brace_count++;
-        if (current == '}') brace_count++;
-        if (current == '[') brace_count--;
-        if (current == '{') brace_count--;
-        if (brace_count < 0) break;
-        pos_tmp --;
+    if ((ns != NULL) && !ns->stale && (ns->generation == generation)) {
+        return ns;
     }
-    pos_cmd = pos_tmp + 1;
 
-    while (isspace (in_buf[pos_cmd]) && (in_buf[pos_cmd] != '\0')) pos_cmd++;
-    while ((!isspace (in_buf[pos_cmd + len_cmd])) && (in_buf[pos_cmd + len_cmd] != '\0')) len_cmd++;
-    str_cmd = g_string_chunk_insert_len (tclln->completion_strings, &(in_buf[pos_cmd]), len_cmd);
+    char *pattern = g_strdup_printf ("%s::*", (strcmp (ns_name, "::") == 0) ? "" : ns_name);
 
-    while ((!isspace (in_buf[pos_start])) && (pos_start > pos_cmd)) pos_start--;
-    if (pos_start > pos_cmd) pos_start++;
-    str_base = g_string_chunk_insert (tclln->completion_strings, &(in_buf[pos_start]));
+    const char *const words[] = {"::info", "vars", pattern};
+    Tcl_Obj *list = index_eval (tclln->tcl_interp, 3, words);
 
-    if (pos_start == pos_cmd) {
-        /* nothing ? */
-        if (len_cmd == 0) return;
+    g_free (pattern);
+    index_sync (tclln);
 
-        /* command or var */
-        if (*str_cmd != '$') {
-            /* complete procs/commands */
-            completion_generate_tcl_procs (tclln->tcl_interp, tclln->completion_strings, &(tclln->completion_list), str_cmd);
-            g_string_truncate (tclln->completion_begin, pos_cmd);
-            return;
-        }
-    }
+    if (list == NULL) return ns;
 
-    /* variable or argument/files */
-    if (*str_base == '$') {
-        /* variable */
-        str_base++;
-        pos_start++;
+    int n_vars;
 
-        /* nothing? */
-        if (*str_base == '\0') return;
+    if (Tcl_ListObjLength (NULL, list, &n_vars) == TCL_OK) {
+        if (ns == NULL) {
+            ns = index_namespace_new (index->namespaces, index->strings, ns_name);
+            ns->stale = true;
+        }
 
-        completion_generate_tcl_vars (tclln->tcl_interp, tclln->completion_strings, &(tclln->completion_list), str_base);
-        g_string_truncate (tclln->completion_begin, pos_start);
-        return;
-    } else {
-        /* argument: */
-        completion_generate_args (tclln->completion_arg_table, tclln->completion_strings, &(tclln->completion_list), str_cmd, str_base);
-        /* files */
-        completion_generate_files (tclln->completion_strings, &(tclln->completion_list), str_base);
+        if (ns->stale || (n_vars != (int) ns->names->len)) {
+            variable_index_fill (tclln, ns, list);
+        }
+
+        ns->stale      = false;
+        ns->generation = generation;
     }
 
-    g_string_truncate (tclln->completion_begin, pos_start);
+    Tcl_DecrRefCount (list);
 
-    return;
+    return ns;
 }
 
-static void completion_add_tcl_result (Tcl_Interp *interp, GStringChunk *gs_chunk, GList **res_list)
+/* replace variables of namespace by list of fully qualified names - new variables get an unset trace */
+static void variable_index_fill (struct tclln_data *tclln, struct index_namespace *ns, Tcl_Obj *list)
 {
-    Tcl_Obj *list = Tcl_GetObjResult (interp);
-
-    int len;
+    int     n_vars;
+    Tcl_Obj **var_objs;
 
-    if (Tcl_ListObjLength (interp, list, &len) != TCL_OK) return;
+    if (Tcl_ListObjGetElements (NULL, list, &n_vars, &var_objs) != TCL_OK) return;
 
-    if (len <= 0) return;
+    g_ptr_array_set_size (ns->names, 0);
 
-    for (int i = 0; i < len; i++) {
-        Tcl_Obj *elem;
+    for (int i = 0; i < n_vars; i++) {
+        const char *full_name = Tcl_GetString (var_objs[i]);
 
-        if (Tcl_ListObjIndex (interp, list, i, &elem) != TCL_OK) continue;
+        g_ptr_array_add (ns->names, g_string_chunk_insert_const (tclln->variable_index.strings, qualified_name_tail (full_name)));
 
-        char * elem_str = g_string_chunk_insert (gs_chunk, Tcl_GetString (elem));
-
-        *res_list = g_list_prepend (*res_list, elem_str);
+        if (Tcl_VarTraceInfo2 (tclln->tcl_interp, full_name, NULL, TCL_GLOBAL_ONLY, variable_index_unset_trace, NULL) == NULL) {
+            Tcl_TraceVar2 (tclln->tcl_interp, full_name, NULL, TCL_GLOBAL_ONLY | TCL_TRACE_UNSETS, variable_index_unset_trace, (ClientData) tclln);
+        }
     }
+
+    g_ptr_array_sort (ns->names, completion_compare);
 }
 
-static void completion_generate_tcl_vars (Tcl_Interp *interp, GStringChunk *gs_chunk, GList **res_list, const char *base)
+/* indexed variable unset - the name may be a local alias, so all namespaces are listed again */
+static char *variable_index_unset_trace (ClientData client_data, Tcl_Interp *interp, const char *name1, const char *name2, int flags)
 {
-    /* vars */
-    GString *tcl_command = g_string_new (NULL);
-    if (tcl_command == NULL) return;
+    if ((flags & TCL_INTERP_DESTROYED) || (name2 != NULL)) return NULL;
 
-    g_string_printf (tcl_command, "info vars %s*\n", base);
+    struct variable_index *index = &((struct tclln_data *) client_data)->variable_index;
 
-    if (Tcl_Eval (interp, tcl_command->str) == TCL_OK) {
-        /* handle result */
-        completion_add_tcl_result (interp, gs_chunk, res_list);
+    if (index->namespaces != NULL) {
+        g_hash_table_foreach (index->namespaces, index_namespace_mark_stale, NULL);
     }
 
-    /* finish */
-    g_string_free (tcl_command, true);
+    return NULL;
 }
 
-static void completion_generate_tcl_procs (Tcl_Interp *interp, GStringChunk *gs_chunk, GList **res_list, const char *base)
+/* keys of array variable (fully qualified) - listed again if marked stale by the trace
+ * returns: NULL if there is no index or the variable is no array with elements */
+static struct variable_array *variable_index_array (struct tclln_data *tclln, const char *array_name)
 {
-    /* commands */
-    GString *tcl_command = g_string_new (NULL);
-    if (tcl_command == NULL) return;
+    struct variable_index *index = &tclln->variable_index;
 
-    g_string_printf (tcl_command, "info commands %s*\n", base);
+    if (!variable_index_create (tclln)) return NULL;
 
-    if (Tcl_Eval (interp, tcl_command->str) == TCL_OK) {
-        /* handle result */
-        completion_add_tcl_result (interp, gs_chunk, res_list);
-    }
+    struct variable_array *array = (struct variable_array *) g_hash_table_lookup (index->arrays, array_name);
 
-    /* procs */
-    g_string_printf (tcl_command, "info procs %s*\n", base);
+    if ((array != NULL) && !array->stale) return array;
 
-    if (Tcl_Eval (interp, tcl_command->str) == TCL_OK) {
-        /* handle result */
-        completion_add_tcl_result (interp, gs_chunk, res_list);
-    }
+    const char *const words[] = {"::array", "names", array_name};
+    Tcl_Obj *list = index_eval (tclln->tcl_interp, 3, words);
 
-    /* finish */
-    g_string_free (tcl_command, true);
-}
+    index_sync (tclln);
 
-static void completion_generate_args (GTree *arg_table, GStringChunk *gs_chunk, GList **res_list, const char *command, const char *base)
-{
-    if (command == NULL) return;
+    int     n_keys = 0;
+    Tcl_Obj **key_objs;
 
-    /* remove "::" at beginning before lookup */
-    if (strlen (command) > 2) {
-        if ((command[0] == ':') && (command[1] == ':')) {
-            command = command+2;
+    if ((list == NULL) || (Tcl_ListObjGetElements (NULL, list, &n_keys, &key_objs) != TCL_OK)) {
+        n_keys = 0;
+    }
+
+    /* no trace on scalars and unknown variables */
+    if (n_keys == 0) {
+        if (list != NULL) {
+            Tcl_DecrRefCount (list);
         }
+        if (array != NULL) {
+            variable_array_drop (tclln, array);
+        }
+        return NULL;
     }
 
-    GList *arg_list = (GList *) g_tree_lookup (arg_table, command);
+    if (array == NULL) {
+        array = (struct variable_array *) alloc_malloc (sizeof (struct variable_array));
 
-    if (arg_list == NULL) return;
+        array->name        = g_strdup (array_name);
+        array->keys        = g_ptr_array_new ();
+        array->key_strings = NULL;
+        array->tclln       = tclln;
 
-    GList *candidates = *res_list;
+        g_hash_table_insert (index->arrays, array->name, array);
 
-    int len = strlen (base);
+        Tcl_TraceVar2 (tclln->tcl_interp, array->name, NULL, TCL_GLOBAL_ONLY | TCL_TRACE_WRITES | TCL_TRACE_UNSETS,
+                       variable_array_trace, (ClientData) array);
+    }
+
+    /* keys are unique - strings of replaced keys are dropped */
+    if (array->key_strings != NULL) {
+        g_string_chunk_free (array->key_strings);
+    }
+    array->key_strings = g_string_chunk_new (4096);
+
+    g_ptr_array_set_size (array->keys, 0);
 
-    for (GList *i_elem = arg_list; i_elem != NULL; i_elem = i_elem->next) {
-        if (strncmp (i_elem->data, base, len) != 0) continue;
+    for (int i = 0; i < n_keys; i++) {
+        int        key_len;
+        const char *key = Tcl_GetStringFromObj (key_objs[i], &key_len);
 
-        candidates = g_list_prepend (candidates, i_elem->data);
+        g_ptr_array_add (array->keys, g_string_chunk_insert_len (array->key_strings, key, key_len));
     }
 
-    *res_list = candidates;
+    g_ptr_array_sort (array->keys, completion_compare);
+
+    array->stale = false;
+
+    Tcl_DecrRefCount (list);
+
+    return array;
 }
 
-static void completion_generate_files (GStringChunk *gs_chunk, GList **res_list, const char *base)
+static void variable_array_drop (struct tclln_data *tclln, struct variable_array *array)
 {
-    GString *path_dir  = g_string_new (base);
-    GString *path_file = NULL;
+    Tcl_UntraceVar2 (tclln->tcl_interp, array->name, NULL, TCL_GLOBAL_ONLY | TCL_TRACE_WRITES | TCL_TRACE_UNSETS,
+                     variable_array_trace, (ClientData) array);
 
-    gssize path_dir_len = path_dir->len - 1;
+    g_hash_table_remove (tclln->variable_index.arrays, array->name);
+}
 
-    /* find last '/' */
-    while ((path_dir_len >= 0) && (path_dir->str[path_dir_len] != '/')) {
-        path_dir_len--;
-    }
+static void variable_array_free (gpointer data)
+{
+    struct variable_array *array = (struct variable_array *) data;
 
-    if (path_dir_len < 0) {
-        path_file = path_dir;
-        path_dir  = g_string_new ("./");
-    } else {
-        path_dir_len++;
-        path_file = g_string_new (&(path_dir->str[path_dir_len]));
-        path_dir  = g_string_truncate (path_dir, path_dir_len);
+    g_ptr_array_free (array->keys, true);
+    if (array->key_strings != NULL) {
+        g_string_chunk_free (array->key_strings);
     }
+    g_free (array->name);
+    alloc_free (array);
+}
 
-    /* open dir and find matching files */
-    DIR *dir = opendir (path_dir->str);
-    if (dir == NULL) goto completion_generate_files_free;
+/* write/unset of indexed array: new or removed keys make it stale - writes of known keys only cost
+ * a binary search */
+static char *variable_array_trace (ClientData client_data, Tcl_Interp *interp, const char *name1, const char *name2, int flags)
+{
+    if (flags & TCL_INTERP_DESTROYED) return NULL;
 
-    GString *temp_result = g_string_new (NULL);
-    GList *candidates = *res_list;
+    struct variable_array *array = (struct variable_array *) client_data;
 
-    for (struct dirent *i_entry = readdir (dir); i_entry != NULL; i_entry = readdir (dir)) {
-        const char *i_name = i_entry->d_name;
+    if ((name2 == NULL) && (flags & TCL_TRACE_DESTROYED)) {
+        /* array unset - tcl removes the trace */
+        g_hash_table_remove (array->tclln->variable_index.arrays, array->name);
+        return NULL;
+    }
 
-        if (strncmp (path_file->str, i_name, path_file->len) != 0) continue;
+    if (array->stale) return NULL;
 
-        if (path_dir_len < 0) {
-            /* clear */
-            temp_result = g_string_set_size (temp_result, 0);
-        } else {
-            /* dir */
-            temp_result = g_string_assign (temp_result, path_dir->str);
-        }
-        temp_result = g_string_append (temp_result, i_name);
+    if ((name2 != NULL) && (flags & TCL_TRACE_WRITES)) {
+        int pos = index_find (array->keys, name2);
 
-        char *i_completion = g_string_chunk_insert (gs_chunk, temp_result->str);
-        candidates = g_list_prepend (candidates, i_completion);
+        if ((pos < (int) array->keys->len) && (strcmp (g_ptr_array_index (array->keys, pos), name2) == 0)) {
+            return NULL;
+        }
     }
 
-    *res_list = candidates;
+    array->stale = true;
 
-    closedir (dir);
-    g_string_free (temp_result, true);
+    return NULL;
+}
+
+/* bytes and number of indexed variables and array keys */
+static void variable_index_usage (struct variable_index *index, size_t *bytes, size_t *entries)
+{
+    index_usage (index->namespaces, bytes, entries);
+
+    if (index->arrays == NULL) return;
+
+    GHashTableIter iter;
+    gpointer       value;
+
+    g_hash_table_iter_init (&iter, index->arrays);
 
-completion_generate_files_free:
-    /* free stuff */
-    g_string_free (path_dir,  true);
-    g_string_free (path_file, true);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        struct variable_array *array = (struct variable_array *) value;
+
+        *bytes += sizeof (struct variable_array) + strlen (array->name) + 1;
+
+        for (guint i = 0; i < array->keys->len; i++) {
+            *bytes += sizeof (gpointer) + strlen (g_ptr_array_index (array->keys, i)) + 1;
+        }
+
+        *entries += array->keys->len;
+    }
 }
 
 /*************************************************
@@ -914,6 +6188,12 @@ static int exit_command (ClientData client_data, Tcl_Interp *interp, int objc, T
     tclln->exit_tcl    = true;
     tclln->return_code = return_code;
 
+    /* file is run: unwind the running command (cannot be caught) */
+    if (tclln->exit_unwind) {
+        Tcl_CancelEval (interp, NULL, NULL, TCL_CANCEL_UNWIND);
+        return TCL_ERROR;
+    }
+
     return TCL_OK;
 }
 
@@ -26,7 +26,38 @@
 extern "C" {
 #endif
 
+/* options for tclln_new_with_options */
+#define TCLLN_LAZY_INIT        (1 << 0)    /* source init library when an unknown command or package is looked up, auto_path is read or clock is used first */
+#define TCLLN_PROFILE_COMMANDS (1 << 1)    /* record call statistics of commands added by tclln_add_command */
+
+/* memory areas of tclln_memory_stats */
+#define TCLLN_MEMORY_COMPLETION_STRINGS     0   /* candidates kept from the last completion */
+#define TCLLN_MEMORY_COMPLETION_ARG_STRINGS 1   /* strings of argument completion (tclln_add_command, tclln::add_completion) */
+#define TCLLN_MEMORY_COMPLETION_ARG_TABLE   2   /* argument lists of commands */
+#define TCLLN_MEMORY_HISTORY                3   /* lines of the shell history - shared by all instances */
+#define TCLLN_MEMORY_LINE_BUFFER            4   /* buffer of the edited line - shared by all instances */
+#define TCLLN_MEMORY_RESULT_BUFFER          5   /* buffer of printed results */
+#define TCLLN_MEMORY_COMMAND_INDEX          6   /* command names for completion */
+#define TCLLN_MEMORY_VARIABLE_INDEX         7   /* variable names and array keys for completion */
+#define TCLLN_MEMORY_DIRECTORY_CACHE        8   /* directory listings for file completion */
+#define TCLLN_MEMORY_SCRIPT_CACHE           9   /* scripts cached for tclln_run_file and source */
+#define TCLLN_MEMORY_AREAS                  10
+
+/* buckets of the latency histogram of tclln_command_stats - bucket i counts calls of [2^i, 2^(i+1)) ns */
+#define TCLLN_COMMAND_HISTOGRAM_SIZE 32
+
 typedef struct tclln_data *TclLN;
+typedef struct tclln_pool *TclLNPool;
+
+/* set allocator of tclln and the line editor (lines, history, completions, temporary data of requests) - process wide
+ * has to be called before any other tclln function - glib containers and the tcl interpreter keep their allocators
+ *   malloc_proc: replacement of malloc (or NULL for malloc)
+ *   realloc_proc: replacement of realloc (or NULL for realloc)
+ *   free_proc: replacement of free (or NULL for free)
+ * the functions have to be thread safe if tclln_run_files_parallel is used
+ */
+void tclln_set_allocator (void *(*malloc_proc) (size_t size), void *(*realloc_proc) (void *ptr, size_t size),
+                void (*free_proc) (void *ptr));
 
 /* initialize and returns TclLN data
  *   prog_name: name of the binary (e.g. = argv[0])
@@ -34,18 +65,93 @@ typedef struct tclln_data *TclLN;
  */
 TclLN tclln_new (const char *prog_name);
 
+/* initialize and returns TclLN data
+ *   prog_name: name of the binary (e.g. = argv[0])
+ *   options: TCLLN_* options combined by |
+ * returns: true on success
+ */
+TclLN tclln_new_with_options (const char *prog_name, int options);
+
+/* get time spent in phases of initialization
+ *   tclln: TclLN data
+ *   create_interp_ns: set to time of creating the interpreter in ns (or NULL)
+ *   encoding_ns: set to time of setting system encoding in ns (or NULL)
+ *   init_ns: set to time of sourcing the init library in ns - also if deferred by TCLLN_LAZY_INIT (or NULL)
+ *   completion_ns: set to time of creating default completion tables in ns (or NULL)
+ */
+void tclln_startup_times (TclLN tclln, unsigned long *create_interp_ns, unsigned long *encoding_ns,
+                unsigned long *init_ns, unsigned long *completion_ns);
+
 /* free resources of TclLN
  *   tclln: pointer to struct whiosl resources should be freed
  */
 void tclln_free (TclLN tclln);
 
+/* create pool of initialized TclLN instances - all instances have to be used in the calling thread
+ *   tclln: TclLN data whose custom commands (see tclln_add_command) are added to each instance - has to stay valid while the pool is used
+ *   size: number of instances to keep ready
+ * returns: pool or NULL on error
+ */
+TclLNPool tclln_pool_new (TclLN tclln, int size);
+
+/* free pool and instances not acquired
+ *   pool: pool to free
+ */
+void tclln_pool_free (TclLNPool pool);
+
+/* take initialized instance from pool - the pool is refilled when the tcl event loop is idle
+ *   pool: pool to take instance from
+ * returns: instance to be freed by tclln_free
+ */
+TclLN tclln_pool_acquire (TclLNPool pool);
+
+/* refill pool up to its size now
+ *   pool: pool to refill
+ */
+void tclln_pool_refill (TclLNPool pool);
+
+/* get acquire statistics of pool
+ *   pool: TclLNPool
+ *   acquires: set to number of acquired instances (or NULL)
+ *   misses: set to number of acquires from empty pool (or NULL)
+ *   latency_avg_ns: set to average latency of acquire in ns (or NULL)
+ *   latency_max_ns: set to maximum latency of acquire in ns (or NULL)
+ */
+void tclln_pool_stats (TclLNPool pool, unsigned long *acquires, unsigned long *misses,
+                unsigned long *latency_avg_ns, unsigned long *latency_max_ns);
+
 /* run shell
+ *   the tcl event loop (timers, file events, sockets) keeps running while waiting for input
  *   tclln: TclLN data
  * returns: true on success
  */
 bool tclln_run (TclLN tclln);
 
-/* run file
+/* limit wall-clock time of each top-level command run by the shell (also from piped input), tclln_run_file and
+ * tclln_run_buffer - Ctrl-C interrupts commands of the shell independent of this (see tclln_set_interrupt_handler)
+ *   tclln: TclLN data
+ *   timeout_ms: time limit in ms - 0 for no limit
+ * commands exceeding the limit are cancelled (see Tcl_CancelEval) - the limit is checked by a watchdog thread
+ */
+void tclln_set_command_timeout (TclLN tclln, unsigned long timeout_ms);
+
+/* let Ctrl-C interrupt commands run by tclln_run_file and tclln_run_buffer too - the shell (tclln_run) always does
+ * while a command runs, a SIGINT handler (with SA_RESTART) replaces the handler of the process - it is installed by
+ * one instance at a time, commands of other instances evaluating meanwhile (e.g. in other threads) are not interrupted
+ *   tclln: TclLN data
+ *   enable: install the handler? - default (false) leaves SIGINT to the application
+ */
+void tclln_set_interrupt_handler (TclLN tclln, bool enable);
+
+/* limit output of command results printed by the shell and tclln_run_file
+ * lists and dicts are printed element by element - they are not converted to a string as a whole
+ *   tclln: TclLN data
+ *   max_bytes: maximum number of bytes printed per result - 0 for no limit
+ *   max_elements: maximum number of list elements or dict entries printed per result - 0 for no limit
+ */
+void tclln_set_result_limit (TclLN tclln, size_t max_bytes, size_t max_elements);
+
+/* run file - top-level commands are evaluated one by one, stopping at the first error (exit also stops the running command)
  *   tclln: TclLN data
  *   filename: file of tcl-script to execute
  *   verbose: print commands and return values?
@@ -53,6 +159,44 @@ bool tclln_run (TclLN tclln);
  */
 bool tclln_run_file (TclLN tclln, const char *script_name, bool verbose);
 
+/* report slowest top-level commands of files run by tclln_run_file
+ * files are evaluated command by command - wall time is recorded for each command, scripts run by a command
+ * (nested tclln_run_file or tclln_run_buffer) count as part of it
+ *   tclln: TclLN data
+ *   top_n: number of commands printed to stderr after each file - 0 to disable
+ *   memory: also record growth of memory allocated by malloc - slows down commands, and memory kept in the
+ *           caches of Tcl's own allocator is not seen
+ */
+void tclln_set_hotspot_report (TclLN tclln, int top_n, bool memory);
+
+/* run script from memory
+ *   tclln: TclLN data
+ *   script: tcl-script to execute - does not need to be null terminated
+ *   length: length of script in bytes
+ * returns: true on success
+ */
+bool tclln_run_buffer (TclLN tclln, const char *script, size_t length);
+
+/* run files in parallel - each thread runs its scripts one after the other in an interpreter of its own with the
+ * commands added to tclln (see tclln_set_parallel_isolation)
+ * output of each script to the stdout and stderr channels is collected and printed in the order of script_names
+ * (output of commands written through C stdio, e.g. printf, is not collected and appears unordered)
+ *   tclln: TclLN data - its interpreter is not used
+ *   script_names: files of tcl-scripts to execute
+ *   n_scripts: number of files
+ *   n_threads: number of threads - 0 for number of processors
+ *   status: array of n_scripts elements set to status of each script (or NULL): 0 on success, 1 on error, or code given to exit
+ * returns: true if all scripts succeeded
+ */
+bool tclln_run_files_parallel (TclLN tclln, const char * const script_names[], int n_scripts, int n_threads, int status[]);
+
+/* run each script of tclln_run_files_parallel in a fresh interpreter - no state is passed from one script to the next
+ * the interpreters are created with TCLLN_LAZY_INIT: the init library is only sourced for scripts that need it
+ *   tclln: TclLN data passed to tclln_run_files_parallel
+ *   isolated: fresh interpreter per script? - default (false) reuses the interpreter of the thread
+ */
+void tclln_set_parallel_isolation (TclLN tclln, bool isolated);
+
 /* add custom tcl command
  *   tclln: pointer to initialized TclLN data where the command should be added
  *   command_name: name of command in tcl shell
@@ -60,10 +204,65 @@ bool tclln_run_file (TclLN tclln, const char *script_name, bool verbose);
  *   command_proc: pointer to function which handles calls to command
  *   client_data: client data handled to function
  *   delete_proc: delete proc for command (see tcl library)
+ * command_proc is also used in the threads of tclln_run_files_parallel - with the same client_data and without delete_proc
  */
 Tcl_Command tclln_add_command (TclLN tclln, const char *command_name, const char * const arg_complete_list[],
                 Tcl_ObjCmdProc *command_proc, ClientData client_data, Tcl_CmdDeleteProc *delete_proc);
 
+/* get call statistics of command added by tclln_add_command - needs option TCLLN_PROFILE_COMMANDS
+ * the statistics are also returned as dict by the tcl-command "tclln::command_stats ?command?"
+ *   tclln: TclLN data
+ *   command_name: name of command
+ *   calls: set to number of calls (or NULL)
+ *   total_ns: set to total time of calls in ns (or NULL)
+ *   min_ns: set to shortest call in ns (or NULL)
+ *   max_ns: set to longest call in ns (or NULL)
+ *   histogram: array set to number of calls per latency bucket (or NULL)
+ * returns: false if the command is unknown or profiling is not enabled
+ */
+bool tclln_command_stats (TclLN tclln, const char *command_name, unsigned long *calls,
+                unsigned long *total_ns, unsigned long *min_ns, unsigned long *max_ns,
+                unsigned long histogram[TCLLN_COMMAND_HISTOGRAM_SIZE]);
+
+/* start sampling profiler - the command running on each level of the call stack is recorded
+ * the profiler is also controlled by the tcl-command "tclln::profile start ?interval_us? | stop | write fileName"
+ *   tclln: TclLN data
+ *   interval_us: sampling interval in us - 0 for default (1 ms) - stretched if sampling takes more than 5% of the run time
+ * returns: false if the profiler is already running
+ * samples of a previous run are discarded
+ */
+bool tclln_profile_start (TclLN tclln, unsigned long interval_us);
+
+/* stop sampling profiler - samples are kept until the next start
+ *   tclln: TclLN data
+ */
+void tclln_profile_stop (TclLN tclln);
+
+/* write samples as folded stacks ("outer;inner;command count" per line) as read by flamegraph tools
+ *   tclln: TclLN data
+ *   file_name: output file
+ * returns: true on success
+ */
+bool tclln_profile_write (TclLN tclln, const char *file_name);
+
+/* get memory held by an area of tclln
+ * the statistics are also returned as dict by the tcl-command "tclln::memory stats"
+ *   tclln: TclLN data
+ *   area: TCLLN_MEMORY_* area
+ *   bytes: set to bytes held (or NULL)
+ *   entries: set to number of strings, arguments or lines held (or NULL)
+ * returns: false if area is unknown
+ */
+bool tclln_memory_stats (TclLN tclln, int area, size_t *bytes, size_t *entries);
+
+/* release memory of caches and buffers that is not needed to keep the current state
+ * completion candidates and the line and result buffers are freed, argument strings of completion are compacted
+ * also available as tcl-command "tclln::memory trim"
+ *   tclln: TclLN data
+ * returns: number of bytes released
+ */
+size_t tclln_memory_trim (TclLN tclln);
+
 /* set prompt string
  *   tclln: TclLN data
  *   prompt_main: normal prompt to show
@@ -71,12 +270,59 @@ Tcl_Command tclln_add_command (TclLN tclln, const char *command_name, const char
  */
 void tclln_set_prompt  (TclLN tclln, const char *prompt_main,  const char *prompt_multiline);
 
+/* set how lines longer than the terminal are edited
+ *   tclln: TclLN data
+ *   single_row: scroll the line horizontally in one row - default (false) wraps it over multiple rows
+ */
+void tclln_set_single_row (TclLN tclln, bool single_row);
+
+/* limit the time completion waits for directories - file completion reads directories by a thread
+ * while other completions are generated, a directory not read within the budget is completed from an
+ * outdated listing (if any) and offered by the next completion
+ *   tclln: TclLN data
+ *   budget_ms: time in ms - default 50, 0 waits until directories are read
+ */
+void tclln_set_completion_budget (TclLN tclln, unsigned long budget_ms);
+
+/* set how completion matches the typed word
+ *   tclln: TclLN data
+ *   fuzzy: offer names containing the characters of the word in order, best matches first (word
+ *          boundaries, consecutive characters), a lowercase word matches both cases - default (false)
+ *          offers names starting with the word
+ */
+void tclln_set_fuzzy_completion (TclLN tclln, bool fuzzy);
+
 /* provide a tcl-command that can add completion information in a tcl script
  *   tclln: TclLN data
  *   command_name: name of command in tcl or NULL for default: "tclln::add_completion"
  */
 void tclln_provide_completion_command (TclLN tclln, const char *command_name);
 
+/* get completions of input as offered by tab in the interactive shell
+ *   tclln: TclLN data
+ *   input: line typed so far
+ * returns: null terminated, sorted (fuzzy: ranked) array of completed lines - free with tclln_free_completions (NULL if nothing matches)
+ */
+char **tclln_complete (TclLN tclln, const char *input);
+
+/* free completions returned by tclln_complete
+ *   completions: array to free
+ */
+void tclln_free_completions (char **completions);
+
+/* replace tcl-command source by a version that caches compiled scripts
+ * scripts are also cached by tclln_run_file - a cached script is reloaded when path, size or mtime of the file change
+ *   tclln: TclLN data
+ */
+void tclln_provide_cached_source (TclLN tclln);
+
+/* get statistics of script cache
+ *   tclln: TclLN data
+ *   hits: set to number of scripts found in cache (or NULL)
+ *   misses: set to number of scripts not found in cache (or NULL)
+ */
+void tclln_script_cache_stats (TclLN tclln, unsigned long *hits, unsigned long *misses);
+
 #ifdef __cplusplus
 }
 #endif